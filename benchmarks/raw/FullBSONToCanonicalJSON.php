@@ -0,0 +1,35 @@
+<?php
+namespace MongoDB\Benchmark\Raw;
+use \MongoDB\Benchmark\BSONDecoding;
+use \MongoDB\Benchmark\Task;
+
+class FullBSONToCanonicalJSON extends BSONDecoding implements Task
+{
+	protected $data;
+
+	function setup()
+	{
+		$this->data = $this->loadFile( "data/full_bson.json" );
+	}
+
+	function beforeTask()
+	{
+	}
+
+	function doTask()
+	{
+		for ( $i = 0; $i < 10000; $i++ )
+		{
+			$json = \MongoDB\BSON\toCanonicalExtendedJSON( $this->data );
+		}
+	}
+
+	function afterTask()
+	{
+	}
+
+	function tearDown()
+	{
+	}
+}
+?>
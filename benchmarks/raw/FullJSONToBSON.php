@@ -0,0 +1,35 @@
+<?php
+namespace MongoDB\Benchmark\Raw;
+use \MongoDB\Benchmark\Base;
+use \MongoDB\Benchmark\Task;
+
+class FullJSONToBSON extends Base implements Task
+{
+	protected $data;
+
+	function setup()
+	{
+		$this->data = file_get_contents( "data/full_bson.json" );
+	}
+
+	function beforeTask()
+	{
+	}
+
+	function doTask()
+	{
+		for ( $i = 0; $i < 10000; $i++ )
+		{
+			$bson = \MongoDB\BSON\fromJSON( $this->data );
+		}
+	}
+
+	function afterTask()
+	{
+	}
+
+	function tearDown()
+	{
+	}
+}
+?>
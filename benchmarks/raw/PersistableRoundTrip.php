@@ -0,0 +1,66 @@
+<?php
+namespace MongoDB\Benchmark\Raw;
+use \MongoDB\Benchmark\Base;
+use \MongoDB\Benchmark\Task;
+
+class PersistableEntity implements \MongoDB\BSON\Persistable
+{
+	public $id;
+	public $name;
+	public $tags;
+
+	function __construct( $id )
+	{
+		$this->id = $id;
+		$this->name = "entity-{$id}";
+		$this->tags = [ "red", "green", "blue" ];
+	}
+
+	function bsonSerialize()
+	{
+		return [ 'id' => $this->id, 'name' => $this->name, 'tags' => $this->tags ];
+	}
+
+	function bsonUnserialize( array $data )
+	{
+		$this->id = $data['id'];
+		$this->name = $data['name'];
+		$this->tags = $data['tags'];
+	}
+}
+
+class PersistableRoundTrip extends Base implements Task
+{
+	protected $entities;
+
+	function setup()
+	{
+		$this->entities = [];
+
+		for ( $i = 0; $i < 100000; $i++ )
+		{
+			$this->entities[] = new PersistableEntity( $i );
+		}
+	}
+
+	function beforeTask()
+	{
+	}
+
+	function doTask()
+	{
+		foreach ( $this->entities as $entity )
+		{
+			$decoded = \MongoDB\BSON\toPHP( \MongoDB\BSON\fromPHP( $entity ) );
+		}
+	}
+
+	function afterTask()
+	{
+	}
+
+	function tearDown()
+	{
+	}
+}
+?>
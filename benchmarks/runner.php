@@ -21,6 +21,10 @@ require 'raw/RunCommand.php';
 require 'raw/FindOneByID.php';
 require 'raw/InsertOneSmallDoc.php';
 require 'raw/InsertOneLargeDoc.php';
+require 'raw/PersistableRoundTrip.php';
+require 'raw/FullJSONToBSON.php';
+require 'raw/FullBSONToCanonicalJSON.php';
+require 'raw/FullBSONToRelaxedJSON.php';
 
 require 'lib/FlatBSONEncoding.php';
 require 'lib/DeepBSONEncoding.php';
@@ -35,6 +39,10 @@ require 'lib/InsertOneLargeDoc.php';
 
 $taskClasses = [
 	'\MongoDB\Benchmark\Raw\FlatBSONEncoding',
+	'\MongoDB\Benchmark\Raw\PersistableRoundTrip',
+	'\MongoDB\Benchmark\Raw\FullJSONToBSON',
+	'\MongoDB\Benchmark\Raw\FullBSONToCanonicalJSON',
+	'\MongoDB\Benchmark\Raw\FullBSONToRelaxedJSON',
 /*
 	'\MongoDB\Benchmark\Raw\DeepBSONEncoding',
 	'\MongoDB\Benchmark\Raw\FullBSONEncoding',
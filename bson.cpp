@@ -17,18 +17,25 @@
 #include "hphp/runtime/vm/native-data.h"
 #include "hphp/runtime/base/array-iterator.h"
 #include "hphp/runtime/base/execution-context.h"
+#include "hphp/runtime/base/packed-array.h"
 #include "hphp/runtime/base/type-string.h"
+#include "hphp/runtime/vm/class.h"
 #include "hphp/util/logger.h"
 
 #include "bson.h"
 #include "utils.h"
 #include "mongodb.h"
+#include <cinttypes>
 #include <iostream>
+#include <string>
+#include <unordered_map>
 
 #include "src/MongoDB/BSON/Binary.h"
 #include "src/MongoDB/BSON/Decimal128.h"
+#include "src/MongoDB/BSON/Document.h"
 #include "src/MongoDB/BSON/Javascript.h"
 #include "src/MongoDB/BSON/ObjectID.h"
+#include "src/MongoDB/BSON/PackedArray.h"
 #include "src/MongoDB/BSON/Regex.h"
 #include "src/MongoDB/BSON/Timestamp.h"
 #include "src/MongoDB/BSON/UTCDateTime.h"
@@ -47,30 +54,24 @@ const StaticString
 	s_document("document"),
 	s_object("object"),
 	s_stdClass("stdClass"),
-	s_array("array");
+	s_array("array"),
+	s_bson("bson"),
+	s_bsonDocument("MongoDB\\BSON\\Document"),
+	s_bsonPackedArray("MongoDB\\BSON\\PackedArray"),
+	s_projection("projection"),
+	s_hydrate("hydrate");
 /* }}} */
 
-int VariantToBsonConverter::_isPackedArray(const Array &a)
-{
-	int idx = 0, key_value = 0;
-
-	for (ArrayIter iter(a); iter; ++iter) {
-		Variant key(iter.first());
-
-		if (!key.isInteger()) {
-			return false;
-		}
-
-		key_value = key.toInt32(); 
-
-		if (idx != key_value) {
-			return false;
-		}
+#ifndef NDEBUG
+namespace {
+	thread_local size_t s_key_allocations = 0;
+}
 
-		idx++;
-	}
-	return true;
+size_t hippo_bson_key_allocations()
+{
+	return s_key_allocations;
 }
+#endif
 
 VariantToBsonConverter::VariantToBsonConverter(const Variant& document, int flags)
 {
@@ -89,7 +90,7 @@ void VariantToBsonConverter::convert(bson_t *bson)
 	}
 }
 
-void VariantToBsonConverter::convertElement(bson_t *bson, const char *key, Variant v)
+void VariantToBsonConverter::convertElement(bson_t *bson, const char *key, const Variant &v)
 {
 	switch (v.getType()) {
 		case KindOfUninit:
@@ -155,34 +156,170 @@ void VariantToBsonConverter::convertDouble(bson_t *bson, const char *key, double
 	bson_append_double(bson, key, -1, v);
 };
 
-void VariantToBsonConverter::convertString(bson_t *bson, const char *key, String v)
+void VariantToBsonConverter::convertString(bson_t *bson, const char *key, const String &v)
 {
 	bson_append_utf8(bson, key, -1, v.c_str(), v.size());
 }
 
-char *VariantToBsonConverter::_getUnmangledPropertyName(String key)
+/* Returns a pointer into the key itself, as the unmangled name is always a
+ * NUL-terminated suffix of the mangled one */
+const char *VariantToBsonConverter::_getUnmangledPropertyName(const char *key, size_t key_len)
 {
-	const char *ckey = key.c_str();
-
-	if (ckey[0] == '\0' && key.length()) {
-		const char *cls = ckey + 1;
+	if (key[0] == '\0' && key_len) {
+		const char *cls = key + 1;
 		if (*cls == '*') { // protected
-			return strdup(ckey + 3);
+			return key + 3;
 		} else {
 			int l = strlen(cls);
-			return strdup(cls + l + 1);
+			return cls + l + 1;
 		}
-	} else {
-		return strdup(ckey);
 	}
+
+	return key;
 }
 
-void VariantToBsonConverter::convertDocument(bson_t *bson, const char *property_name, Variant v)
+void VariantToBsonConverter::_checkForId(const char *key, size_t key_len, const Variant &data)
 {
-	bson_t child;
-	int unmangle = 0;
-	Array document;
+	/* If we have an ID, we don't need to add it. But we also need to
+	 * set m_out to the value! */
+	if (strncmp(key, "_id", key_len) == 0) {
+		m_flags &= ~HIPPO_BSON_ADD_ID;
+		if (m_flags & HIPPO_BSON_RETURN_ID) {
+			/* FIXME: Should we add a ref here? */
+			m_out = data;
+		}
+	}
+}
+
+void VariantToBsonConverter::_convertKeyedElement(bson_t *bson, const char *key, size_t key_len, const Variant &data, bool unmangle)
+{
+	if (m_level == 0 && (m_flags & HIPPO_BSON_ADD_ID)) {
+		_checkForId(key, key_len, data);
+	}
+
+	m_level++;
+	convertElement(bson, unmangle ? _getUnmangledPropertyName(key, key_len) : key, data);
+	m_level--;
+}
+
+const StaticString s_MongoDriverBsonODM_fieldName("__pclass");
+
+static bool hippo_bson_is_pclass_key(const char *key, size_t key_len)
+{
+	return key_len == (size_t) s_MongoDriverBsonODM_fieldName.size() && memcmp(key, s_MongoDriverBsonODM_fieldName.data(), key_len) == 0;
+}
+
+void VariantToBsonConverter::_convertArrayElements(bson_t *bson, const ArrayData *ad, bool unmangle, bool skip_pclass)
+{
+	for (ArrayIter iter(ad); iter; ++iter) {
+		Variant key(iter.first());
+		const Variant& data(iter.secondRef());
+
+		if (key.isInteger()) {
+			char int_key[24];
+			int int_key_len;
+
+			int_key_len = snprintf(int_key, sizeof(int_key), "%" PRId64, key.toInt64());
+			_convertKeyedElement(bson, int_key, int_key_len, data, false);
+		} else {
+			const StringData *s_key = key.getStringData();
+
+			if (skip_pclass && hippo_bson_is_pclass_key(s_key->data(), s_key->size())) {
+				continue;
+			}
+
+			_convertKeyedElement(bson, s_key->data(), s_key->size(), data, unmangle);
+		}
+	}
+}
+
+/* Packed arrays have keys 0..n-1 in order, so the keys come straight from
+ * libbson's table of precomputed index strings instead of from the array */
+void VariantToBsonConverter::_convertPackedArrayElements(bson_t *bson, const ArrayData *ad)
+{
+	uint32_t index = 0;
+
+	for (ssize_t pos = ad->iter_begin(); pos != ad->iter_end(); pos = ad->iter_advance(pos), index++) {
+		const char *key;
+		char buf[16];
+		size_t key_len;
+
+		key_len = bson_uint32_to_string(index, &key, buf, sizeof(buf));
+		_convertKeyedElement(bson, key, key_len, ad->getValueRef(pos), false);
+	}
+}
+
+static bool hippo_bson_prop_redeclared(const Class *cls, const Class *declaring_cls, const StringData *name)
+{
+	for (const Class *k = cls; k != declaring_cls; k = k->parent()) {
+		if (k->preClass()->hasProp(name)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Walks the declared properties of the object's class hierarchy in the same
+ * order as o_toIterArray() does (most derived class first, in declaration
+ * order), followed by the dynamic properties, without copying them into a
+ * temporary array first. Only public properties are visible from the
+ * (empty) context we encode from. */
+void VariantToBsonConverter::_convertObjectProperties(bson_t *bson, ObjectData *obj, bool skip_pclass)
+{
+	const Class *cls = obj->getVMClass();
 
+	if (obj->isCollection()) {
+		Array document = obj->o_toIterArray(null_string, ObjectData::PreserveRefs);
+
+#ifndef NDEBUG
+		/* The array, and a copy of each of its keys */
+		s_key_allocations += 1 + document.size();
+#endif
+		_convertArrayElements(bson, document.get(), true, skip_pclass);
+		return;
+	}
+
+	for (const Class *k = cls; k; k = k->parent()) {
+		const PreClass *pcls = k->preClass();
+		const PreClass::Prop *props = pcls->properties();
+		size_t num_props = pcls->numProperties();
+
+		for (size_t i = 0; i < num_props; i++) {
+			const StringData *name = props[i].name();
+			const TypedValue *prop;
+			Slot slot;
+
+			if (!(props[i].attrs() & AttrPublic)) {
+				continue;
+			}
+			if (k != cls && hippo_bson_prop_redeclared(cls, k, name)) {
+				continue;
+			}
+			if (skip_pclass && hippo_bson_is_pclass_key(name->data(), name->size())) {
+				continue;
+			}
+
+			slot = cls->lookupDeclProp(name);
+			assert(slot != kInvalidSlot);
+
+			prop = &obj->propVec()[slot];
+			if (prop->m_type == KindOfUninit) {
+				/* unset() property */
+				continue;
+			}
+
+			_convertKeyedElement(bson, name->data(), name->size(), tvAsCVarRef(prop), false);
+		}
+	}
+
+	if (obj->getAttribute(ObjectData::HasDynPropArr)) {
+		_convertArrayElements(bson, obj->dynPropArray().get(), true, skip_pclass);
+	}
+}
+
+void VariantToBsonConverter::convertDocument(bson_t *bson, const char *property_name, const Variant &v)
+{
 	/* if we are not at a top-level, we need to check (and convert) special
 	 * BSON types too */
 	if (v.isObject()) {
@@ -191,72 +328,50 @@ void VariantToBsonConverter::convertDocument(bson_t *bson, const char *property_
 		}
 		/* The "convertSpecialObject" method didn't understand this type, so we
 		 * will continue treating this as a normal document */
+		_convertDocument(bson, property_name, v, false, NULL);
+	} else {
+		/* Only packed arrays (keys 0..n-1, in order) become BSON arrays */
+		_convertDocument(bson, property_name, v, v.getArrayData()->isVectorData(), NULL);
 	}
+}
 
-	document = v.toObject()->o_toIterArray(null_string, ObjectData::PreserveRefs);
+/* Writes out the elements of an array or object. If 'pclass' is set, any
+ * existing "__pclass" element is dropped, and the class name is appended as
+ * the last element instead. */
+void VariantToBsonConverter::_convertDocument(bson_t *bson, const char *property_name, const Variant &v, bool is_array, const Class *pclass)
+{
+	bson_t child;
+	bson_t *target = bson;
 
-	if (_isPackedArray(document) && !v.isObject()) {
-		if (property_name != NULL) {
+	if (property_name != NULL) {
+		if (is_array) {
 			bson_append_array_begin(bson, property_name, -1, &child);
-		}
-	} else {
-		unmangle = 1;
-		if (property_name != NULL) {
+		} else {
 			bson_append_document_begin(bson, property_name, -1, &child);
 		}
+		target = &child;
 	}
 
-	for (ArrayIter iter(document); iter; ++iter) {
-		Variant key(iter.first());
-		const Variant& data(iter.secondRef());
-		String s_key = key.toString();
-
-		if (m_level == 0 && (m_flags & HIPPO_BSON_ADD_ID)) {
-			/* If we have an ID, we don't need to add it. But we also need to
-			 * set m_out to the value! */
-			if (strncmp(s_key.c_str(), "_id", s_key.length()) == 0) {
-				m_flags &= ~HIPPO_BSON_ADD_ID;
-				if (m_flags & HIPPO_BSON_RETURN_ID) {
-					/* FIXME: Should we add a ref here? */
-					m_out = data;
-				}
-			}
-		}
+	if (v.isObject()) {
+		_convertObjectProperties(target, v.getObjectData(), pclass != NULL);
+	} else if (is_array) {
+		_convertPackedArrayElements(target, v.getArrayData());
+	} else {
+		_convertArrayElements(target, v.getArrayData(), true, pclass != NULL);
+	}
 
-		m_level++;
-		if (unmangle) {
-			const char *unmangledName;
+	if (pclass) {
+		const StringData *class_name = pclass->name();
 
-			unmangledName = _getUnmangledPropertyName(s_key);
-			convertElement(property_name != NULL ? &child : bson, unmangledName, data);
-			free((void*) unmangledName);
-		} else {
-			convertElement(property_name != NULL ? &child : bson, s_key.c_str(), data);
-		}
-		m_level--;
+		bson_append_binary(target, s_MongoDriverBsonODM_fieldName.data(), -1, (bson_subtype_t) 0x80, (const uint8_t*) class_name->data(), class_name->size());
 	}
 
 	if (m_level == 0 && (m_flags & HIPPO_BSON_ADD_ID)) {
-		bson_oid_t oid;
-
-		bson_oid_init(&oid, NULL);
-		bson_append_oid(bson, "_id", strlen("_id"), &oid);
-
-		if (m_flags & HIPPO_BSON_RETURN_ID) {
-			static Class* c_objectId;
-			c_objectId = Unit::lookupClass(s_MongoBsonObjectID_className.get());
-			assert(c_objectId);
-			Object obj = Object{c_objectId};
-
-			MongoDBBsonObjectIDData* obj_data = Native::data<MongoDBBsonObjectIDData>(obj.get());
-			bson_oid_copy(&oid, &obj_data->m_oid);
-
-			m_out = obj;
-		}
+		_appendId(bson);
 	}
 
 	if (property_name != NULL) {
-		if (_isPackedArray(document)) {
+		if (is_array) {
 			bson_append_array_end(bson, &child);
 		} else {
 			bson_append_document_end(bson, &child);
@@ -264,6 +379,25 @@ void VariantToBsonConverter::convertDocument(bson_t *bson, const char *property_
 	}
 }
 
+void VariantToBsonConverter::_appendId(bson_t *bson)
+{
+	bson_oid_t oid;
+
+	bson_oid_init(&oid, NULL);
+	bson_append_oid(bson, "_id", strlen("_id"), &oid);
+
+	if (m_flags & HIPPO_BSON_RETURN_ID) {
+		static Class* c_objectId;
+		HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_objectId, s_MongoBsonObjectID_className);
+		Object obj = Object{c_objectId};
+
+		MongoDBBsonObjectIDData* obj_data = Native::data<MongoDBBsonObjectIDData>(obj.get());
+		bson_oid_copy(&oid, &obj_data->m_oid);
+
+		m_out = obj;
+	}
+}
+
 /* {{{ Serialization of types */
 const StaticString s_MongoDriverBsonType_className("MongoDB\\BSON\\Type");
 const StaticString s_MongoDriverBsonPersistable_className("MongoDB\\BSON\\Persistable");
@@ -271,15 +405,13 @@ const StaticString s_MongoDriverBsonSerializable_className("MongoDB\\BSON\\Seria
 const StaticString s_MongoDriverBsonUnserializable_className("MongoDB\\BSON\\Unserializable");
 const StaticString s_MongoDriverBsonSerializable_functionName("bsonSerialize");
 const StaticString s_MongoDriverBsonUnserializable_functionName("bsonUnserialize");
-const StaticString s_MongoDriverBsonODM_fieldName("__pclass");
 
 /* {{{ MongoDriver\BSON\Binary */
 void VariantToBsonConverter::_convertBinary(bson_t *bson, const char *key, Object v)
 {
-	String data = v.o_get(s_MongoBsonBinary_data, false, s_MongoBsonBinary_className).toString();
-	int64_t type = v.o_get(s_MongoBsonBinary_type, false, s_MongoBsonBinary_className).toInt64();
+	MongoDBBsonBinaryData* data = Native::data<MongoDBBsonBinaryData>(v.get());
 
-	bson_append_binary(bson, key, -1, (bson_subtype_t) type, (const unsigned char*) data.c_str(), data.length());
+	bson_append_binary(bson, key, -1, data->m_type, (const unsigned char*) data->m_data.c_str(), data->m_data.length());
 }
 /* }}} */
 
@@ -296,8 +428,9 @@ void VariantToBsonConverter::_convertDecimal128(bson_t *bson, const char *key, O
 void VariantToBsonConverter::_convertJavascript(bson_t *bson, const char *key, Object v)
 {
 	bson_t *scope_bson;
-	String code = v.o_get(s_MongoBsonJavascript_code, false, s_MongoBsonJavascript_className).toString();
-	auto scope = v.o_get(s_MongoBsonJavascript_scope, false, s_MongoBsonJavascript_className);
+	MongoDBBsonJavascriptData* data = Native::data<MongoDBBsonJavascriptData>(v.get());
+	const String& code = data->m_code;
+	const Variant& scope = data->m_scope;
 
 	if (scope.isObject() || scope.isArray()) {
 		/* Convert scope to document */
@@ -306,6 +439,7 @@ void VariantToBsonConverter::_convertJavascript(bson_t *bson, const char *key, O
 		converter.convert(scope_bson);
 
 		bson_append_code_with_scope(bson, key, -1, (const char*) code.c_str(), scope_bson);
+		bson_destroy(scope_bson);
 	} else {
 		bson_append_code(bson, key, -1, (const char*) code.c_str());
 	}
@@ -343,49 +477,297 @@ void VariantToBsonConverter::_convertObjectID(bson_t *bson, const char *key, Obj
 
 void VariantToBsonConverter::_convertRegex(bson_t *bson, const char *key, Object v)
 {
-	String regex = v.o_get(s_MongoBsonRegex_pattern, false, s_MongoBsonRegex_className).toString();
-	String flags = v.o_get(s_MongoBsonRegex_flags, false, s_MongoBsonRegex_className).toString();
+	MongoDBBsonRegexData* data = Native::data<MongoDBBsonRegexData>(v.get());
 
-	bson_append_regex(bson, key, -1, regex.c_str(), flags.c_str());
+	bson_append_regex(bson, key, -1, data->m_pattern.c_str(), data->m_flags.c_str());
 }
 /* }}} */
 
 /* {{{ MongoDriver\BSON\Timestamp */
 void VariantToBsonConverter::_convertTimestamp(bson_t *bson, const char *key, Object v)
 {
-	int32_t timestamp = v.o_get(s_MongoBsonTimestamp_timestamp, false, s_MongoBsonTimestamp_className).toInt32();
-	int32_t increment = v.o_get(s_MongoBsonTimestamp_increment, false, s_MongoBsonTimestamp_className).toInt32();
+	MongoDBBsonTimestampData* data = Native::data<MongoDBBsonTimestampData>(v.get());
 
-	bson_append_timestamp(bson, key, -1, timestamp, increment);
+	bson_append_timestamp(bson, key, -1, data->m_timestamp, data->m_increment);
 }
 
 /* {{{ MongoDriver\BSON\UTCDateTime */
 void VariantToBsonConverter::_convertUTCDateTime(bson_t *bson, const char *key, Object v)
 {
-	int64_t milliseconds = v.o_get(s_MongoBsonUTCDateTime_milliseconds, false, s_MongoBsonUTCDateTime_className).toInt64();
+	MongoDBBsonUTCDateTimeData* data = Native::data<MongoDBBsonUTCDateTimeData>(v.get());
 
-	bson_append_date_time(bson, key, -1, milliseconds);
+	bson_append_date_time(bson, key, -1, data->m_milliseconds);
+}
+/* }}} */
+
+/* {{{ MongoDriver\BSON\Document */
+/* The raw bytes are copied over as they are. At the root level the elements
+ * are appended to the (empty) root document instead, which still needs the
+ * same "_id" handling as a document built from PHP values. */
+void VariantToBsonConverter::_convertBsonDocument(bson_t *bson, const char *key, Object v)
+{
+	MongoDBBsonDocumentData* data = Native::data<MongoDBBsonDocumentData>(v.get());
+	bson_t document;
+	bson_iter_t iter;
+
+	if (!hippo_bson_view_init(&document, data->m_data, data->m_offset, data->m_length)) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Detected corrupt BSON data");
+	}
+
+	if (key != NULL) {
+		bson_append_document(bson, key, -1, &document);
+		return;
+	}
+
+	bson_concat(bson, &document);
+
+	if (m_level == 0 && (m_flags & HIPPO_BSON_ADD_ID)) {
+		if (bson_iter_init_find(&iter, &document, "_id")) {
+			if (m_flags & HIPPO_BSON_RETURN_ID) {
+				m_out = hippo_bson_view_element(data->m_data, &iter);
+			}
+		} else {
+			_appendId(bson);
+		}
+	}
+}
+/* }}} */
+
+/* {{{ MongoDriver\BSON\PackedArray */
+void VariantToBsonConverter::_convertBsonPackedArray(bson_t *bson, const char *key, Object v)
+{
+	MongoDBBsonPackedArrayData* data = Native::data<MongoDBBsonPackedArrayData>(v.get());
+	bson_t array;
+
+	if (!hippo_bson_view_init(&array, data->m_data, data->m_offset, data->m_length)) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Detected corrupt BSON data");
+	}
+
+	bson_append_array(bson, key, -1, &array);
+}
+/* }}} */
+
+/* {{{ Per-request class cache
+ *
+ * User classes only live as long as the request that declared them, so a
+ * Class* can not be used as a key across requests. The cache is therefore
+ * thread local, and emptied by hippo_bson_cache_reset() at request shutdown. */
+typedef struct {
+	int         encoder_kind;
+	bool        is_persistable;
+	bool        is_unserializable;
+	const Func *serialize_func;
+	const Func *unserialize_func;
+	bool hydrate_slots_resolved;
+	std::unordered_map<std::string, Slot> hydrate_slots;
+} hippo_bson_class_info_t;
+
+namespace {
+	thread_local std::unordered_map<const Class*, hippo_bson_class_info_t> s_class_info;
+}
+
+static bool hippo_bson_class_is(const Class *cls, const StaticString &name)
+{
+	const Class *other = Unit::lookupClass(name.get());
+
+	return other && cls->classof(other);
+}
+
+static int hippo_bson_determine_encoder_kind(const Class *cls)
+{
+	if (!hippo_bson_class_is(cls, s_MongoDriverBsonType_className)) {
+		return HIPPO_BSON_ENCODE_DOCUMENT;
+	}
+
+	if (hippo_bson_class_is(cls, s_MongoDriverBsonPersistable_className)) {
+		return HIPPO_BSON_ENCODE_PERSISTABLE;
+	}
+	if (hippo_bson_class_is(cls, s_MongoDriverBsonSerializable_className)) {
+		return HIPPO_BSON_ENCODE_SERIALIZABLE;
+	}
+
+	if (hippo_bson_class_is(cls, s_MongoBsonDocument_className)) {
+		return HIPPO_BSON_ENCODE_BSONDOCUMENT;
+	}
+	if (hippo_bson_class_is(cls, s_MongoBsonPackedArray_className)) {
+		return HIPPO_BSON_ENCODE_BSONPACKEDARRAY;
+	}
+
+	if (hippo_bson_class_is(cls, s_MongoBsonBinary_className)) {
+		return HIPPO_BSON_ENCODE_BINARY;
+	}
+	if (hippo_bson_class_is(cls, s_MongoBsonDecimal128_className)) {
+		return HIPPO_BSON_ENCODE_DECIMAL128;
+	}
+	if (hippo_bson_class_is(cls, s_MongoBsonJavascript_className)) {
+		return HIPPO_BSON_ENCODE_JAVASCRIPT;
+	}
+	if (hippo_bson_class_is(cls, s_MongoBsonMaxKey_className)) {
+		return HIPPO_BSON_ENCODE_MAXKEY;
+	}
+	if (hippo_bson_class_is(cls, s_MongoBsonMinKey_className)) {
+		return HIPPO_BSON_ENCODE_MINKEY;
+	}
+	if (hippo_bson_class_is(cls, s_MongoBsonObjectID_className)) {
+		return HIPPO_BSON_ENCODE_OBJECTID;
+	}
+	if (hippo_bson_class_is(cls, s_MongoBsonRegex_className)) {
+		return HIPPO_BSON_ENCODE_REGEX;
+	}
+	if (hippo_bson_class_is(cls, s_MongoBsonTimestamp_className)) {
+		return HIPPO_BSON_ENCODE_TIMESTAMP;
+	}
+	if (hippo_bson_class_is(cls, s_MongoBsonUTCDateTime_className)) {
+		return HIPPO_BSON_ENCODE_UTCDATETIME;
+	}
+
+	return HIPPO_BSON_ENCODE_UNKNOWN_TYPE;
+}
+
+static hippo_bson_class_info_t *hippo_bson_get_class_info(const Class *cls)
+{
+	auto it = s_class_info.find(cls);
+
+	if (it != s_class_info.end()) {
+		return &it->second;
+	}
+
+	hippo_bson_class_info_t info;
+
+	info.encoder_kind = hippo_bson_determine_encoder_kind(cls);
+	info.is_persistable = hippo_bson_class_is(cls, s_MongoDriverBsonPersistable_className);
+	info.is_unserializable = hippo_bson_class_is(cls, s_MongoDriverBsonUnserializable_className);
+	info.serialize_func = NULL;
+	info.unserialize_func = NULL;
+	info.hydrate_slots_resolved = false;
+
+	if (info.encoder_kind == HIPPO_BSON_ENCODE_SERIALIZABLE || info.encoder_kind == HIPPO_BSON_ENCODE_PERSISTABLE) {
+		info.serialize_func = cls->lookupMethod(s_MongoDriverBsonSerializable_functionName.get());
+	}
+	if (info.is_unserializable) {
+		info.unserialize_func = cls->lookupMethod(s_MongoDriverBsonUnserializable_functionName.get());
+	}
+
+	return &(s_class_info[cls] = std::move(info));
+}
+
+/* Slots of the declared properties of a class, by name, for hydration. A
+ * private property of a parent class that is declared again in a subclass
+ * has a slot of its own; the subclass' property comes later and wins. */
+static const std::unordered_map<std::string, Slot> *hippo_bson_get_hydrate_slots(const Class *cls)
+{
+	hippo_bson_class_info_t *info = hippo_bson_get_class_info(cls);
+
+	if (!info->hydrate_slots_resolved) {
+		size_t num_props = cls->numDeclProperties();
+
+		for (size_t i = 0; i < num_props; i++) {
+			const StringData *name = cls->declProperties()[i].name;
+
+			info->hydrate_slots[std::string(name->data(), name->size())] = i;
+		}
+		info->hydrate_slots_resolved = true;
+	}
+
+	return &info->hydrate_slots;
+}
+
+/* Class lookups for __pclass names, including the ones that do not resolve
+ * to a class, so that the autoloader is only tried once per name. The names
+ * come from the data, so the cache is capped. */
+#define HIPPO_BSON_PCLASS_CACHE_MAX 1024
+
+namespace {
+	thread_local std::unordered_map<std::string, Class*> s_pclass_cache;
+	thread_local std::string s_pclass_key;
+	thread_local std::string s_slot_key;
+}
+
+/* Also used for the class names from the type map, which would otherwise be
+ * looked up again for every document */
+static Class *hippo_bson_lookup_pclass(const String &class_name)
+{
+	s_pclass_key.assign(class_name.data(), class_name.size());
+
+	auto it = s_pclass_cache.find(s_pclass_key);
+
+	if (it != s_pclass_cache.end()) {
+		return it->second;
+	}
+
+	Class *cls = Unit::getClass(class_name.get(), true);
+
+	if (s_pclass_cache.size() >= HIPPO_BSON_PCLASS_CACHE_MAX) {
+		s_pclass_cache.clear();
+	}
+	s_pclass_cache.emplace(s_pclass_key, cls);
+
+	return cls;
+}
+
+/* Decoded field names. Result sets repeat the same handful of keys in every
+ * document, so each key is looked up in a small direct-mapped table of
+ * strings before a new one gets allocated. Strings handed out from the
+ * table keep their hash once they have been inserted into an array. */
+#define HIPPO_BSON_KEY_CACHE_SIZE    256
+#define HIPPO_BSON_KEY_CACHE_MAX_LEN 64
+
+namespace {
+	thread_local String s_key_cache[HIPPO_BSON_KEY_CACHE_SIZE];
+}
+
+static String hippo_bson_intern_key(const char *key)
+{
+	uint32_t hash = 2166136261u;
+	size_t key_len = 0;
+
+	/* FNV-1a, which also takes care of finding the length */
+	while (key[key_len]) {
+		hash = (hash ^ (unsigned char) key[key_len]) * 16777619u;
+		key_len++;
+	}
+
+	if (key_len > HIPPO_BSON_KEY_CACHE_MAX_LEN) {
+		return String(key, key_len, CopyString);
+	}
+
+	String &slot = s_key_cache[hash & (HIPPO_BSON_KEY_CACHE_SIZE - 1)];
+
+	if (slot.isNull() || (size_t) slot.size() != key_len || memcmp(slot.data(), key, key_len) != 0) {
+		slot = String(key, key_len, CopyString);
+	}
+
+	return slot;
+}
+
+void hippo_bson_cache_reset()
+{
+	s_class_info.clear();
+	s_pclass_cache.clear();
+
+	for (int i = 0; i < HIPPO_BSON_KEY_CACHE_SIZE; i++) {
+		s_key_cache[i].reset();
+	}
 }
 /* }}} */
 
 /* {{{ Special objects that implement MongoDB\BSON\Serializable */
-void VariantToBsonConverter::_convertSerializable(bson_t *bson, const char *key, Object v)
+void VariantToBsonConverter::_convertSerializable(bson_t *bson, const char *key, Object v, bool persistable)
 {
 	Variant result;
-	Array   properties;
-	TypedValue args[1] = { *(Variant(v)).asCell() };
 	Class *cls;
-	Func *m;
+	const Func *m;
 
 	cls = v.get()->getVMClass();
-	m = cls->lookupMethod(s_MongoDriverBsonSerializable_functionName.get());
-	
+	m = hippo_bson_get_class_info(cls)->serialize_func;
+
+	/* bsonSerialize() takes no arguments */
 	g_context->invokeFuncFew(
 		result.asTypedValue(),
 		m,
 		v.get(),
 		nullptr,
-		1, args
+		0, nullptr
 	);
 
 	if ( ! (
@@ -405,20 +787,13 @@ void VariantToBsonConverter::_convertSerializable(bson_t *bson, const char *key,
 		throw MongoDriver::Utils::throwUnexpectedValueException((char*) full_name.toString().c_str());
 	}
 
-	/* Convert to array so that we can handle it well */
-	properties = result.toArray();
-
-	if (v.instanceof(s_MongoDriverBsonPersistable_className)) {
-		const char *class_name = cls->nameStr().c_str();
-		Object obj = createMongoBsonBinaryObject(
-			(const uint8_t *) class_name,
-			strlen(class_name),
-			(bson_subtype_t) 0x80
-		);
-		properties.add(String(s_MongoDriverBsonODM_fieldName), obj);
+	/* Persistable objects always become documents, as their class name gets
+	 * added as an extra "__pclass" element */
+	if (persistable) {
+		_convertDocument(bson, key, result, false, cls);
+	} else {
+		_convertDocument(bson, key, result, result.isArray() && result.getArrayData()->isVectorData(), NULL);
 	}
-
-	convertDocument(bson, key, result.isObject() ? Variant(Variant(properties).toObject()) : Variant(properties));
 }
 /* }}} */
 
@@ -426,56 +801,60 @@ void VariantToBsonConverter::_convertSerializable(bson_t *bson, const char *key,
 
 bool VariantToBsonConverter::convertSpecialObject(bson_t *bson, const char *key, Object v)
 {
-	if (v.instanceof(s_MongoDriverBsonType_className)) {
-		if (v.instanceof(s_MongoDriverBsonSerializable_className)) {
-			_convertSerializable(bson, key, v);
+	int kind = hippo_bson_get_class_info(v.get()->getVMClass())->encoder_kind;
+
+	switch (kind) {
+		case HIPPO_BSON_ENCODE_DOCUMENT:
+			return false;
+
+		case HIPPO_BSON_ENCODE_SERIALIZABLE:
+		case HIPPO_BSON_ENCODE_PERSISTABLE:
+			_convertSerializable(bson, key, v, kind == HIPPO_BSON_ENCODE_PERSISTABLE);
 			return true;
-		}
 
-		if (m_level == 0) {
-			throw MongoDriver::Utils::throwUnexpectedValueException("MongoDB\\BSON\\Type instance " + String(v->getClassName())+ " cannot be serialized as a root element");
-		}
+		case HIPPO_BSON_ENCODE_BSONDOCUMENT:
+			_convertBsonDocument(bson, key, v);
+			return true;
+	}
+
+	if (m_level == 0) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("MongoDB\\BSON\\Type instance " + String(v->getClassName())+ " cannot be serialized as a root element");
+	}
 
-		if (v.instanceof(s_MongoBsonBinary_className)) {
+	switch (kind) {
+		case HIPPO_BSON_ENCODE_BSONPACKEDARRAY:
+			_convertBsonPackedArray(bson, key, v);
+			return true;
+		case HIPPO_BSON_ENCODE_BINARY:
 			_convertBinary(bson, key, v);
 			return true;
-		}
-		if (v.instanceof(s_MongoBsonDecimal128_className)) {
+		case HIPPO_BSON_ENCODE_DECIMAL128:
 			_convertDecimal128(bson, key, v);
 			return true;
-		}
-		if (v.instanceof(s_MongoBsonJavascript_className)) {
+		case HIPPO_BSON_ENCODE_JAVASCRIPT:
 			_convertJavascript(bson, key, v);
 			return true;
-		}
-		if (v.instanceof(s_MongoBsonMaxKey_className)) {
+		case HIPPO_BSON_ENCODE_MAXKEY:
 			_convertMaxKey(bson, key, v);
 			return true;
-		}
-		if (v.instanceof(s_MongoBsonMinKey_className)) {
+		case HIPPO_BSON_ENCODE_MINKEY:
 			_convertMinKey(bson, key, v);
 			return true;
-		}
-		if (v.instanceof(s_MongoBsonObjectID_className)) {
+		case HIPPO_BSON_ENCODE_OBJECTID:
 			_convertObjectID(bson, key, v);
 			return true;
-		}
-		if (v.instanceof(s_MongoBsonRegex_className)) {
+		case HIPPO_BSON_ENCODE_REGEX:
 			_convertRegex(bson, key, v);
 			return true;
-		}
-		if (v.instanceof(s_MongoBsonTimestamp_className)) {
+		case HIPPO_BSON_ENCODE_TIMESTAMP:
 			_convertTimestamp(bson, key, v);
 			return true;
-		}
-		if (v.instanceof(s_MongoBsonUTCDateTime_className)) {
+		case HIPPO_BSON_ENCODE_UTCDATETIME:
 			_convertUTCDateTime(bson, key, v);
 			return true;
-		}
-
-		throw MongoDriver::Utils::throwUnexpectedValueException("Unexpected MongoDB\\BSON\\Type instance: " + String(v->getClassName()));
 	}
-	return false;
+
+	throw MongoDriver::Utils::throwUnexpectedValueException("Unexpected MongoDB\\BSON\\Type instance: " + String(v->getClassName()));
 }
 /* }}} */
 /* }}} */
@@ -483,11 +862,43 @@ bool VariantToBsonConverter::convertSpecialObject(bson_t *bson, const char *key,
 /* {{{ BSON → HHVM */
 BsonToVariantConverter::BsonToVariantConverter(const unsigned char *data, int data_len, hippo_bson_conversion_options_t options)
 {
-	m_reader = bson_reader_new_from_data(data, data_len);
+	m_data = data;
+	m_data_len = data_len;
 	m_options = options;
 }
 
+static void hippo_bson_decode_compound(bson_iter_t *iter, const hippo_bson_conversion_options_t *options, int compound_type, Variant *v);
+
 /* {{{ Visitors */
+/* BSON arrays always have the keys "0", "1", ..., so their elements are
+ * appended to a packed array instead of being added by key */
+static inline void hippo_bson_state_add(hippo_bson_state *state, const char *key, const Variant &v)
+{
+	if (state->options.current_compound_type == HIPPO_BSONTYPE_ARRAY) {
+		state->zchild.append(v);
+	} else if (!state->object.isNull()) {
+		size_t key_len = strlen(key);
+
+		if (hippo_bson_is_pclass_key(key, key_len)) {
+			return;
+		}
+
+		/* Properties are written directly, so that neither visibility nor
+		 * __set() get in the way */
+		s_slot_key.assign(key, key_len);
+
+		auto it = state->object_slots->find(s_slot_key);
+
+		if (it != state->object_slots->end()) {
+			tvAsVariant(&state->object->propVec()[it->second]) = v;
+		} else {
+			state->object->reserveProperties().set(hippo_bson_intern_key(key), v, true);
+		}
+	} else {
+		state->zchild.add(hippo_bson_intern_key(key), v);
+	}
+}
+
 void hippo_bson_visit_corrupt(const bson_iter_t *iter __attribute__((unused)), void *data)
 {
 	Logger::Verbose("[HIPPO] Corrupt BSON data detected!");
@@ -499,7 +910,7 @@ bool hippo_bson_visit_double(const bson_iter_t *iter __attribute__((unused)), co
 {
 	hippo_bson_state *state = (hippo_bson_state*) data;
 
-	state->zchild.add(String::FromCStr(key), Variant(v_double));
+	hippo_bson_state_add(state, key, Variant(v_double));
 	return false;
 }
 
@@ -507,36 +918,50 @@ bool hippo_bson_visit_utf8(const bson_iter_t *iter __attribute__((unused)), cons
 {
 	hippo_bson_state *state = (hippo_bson_state*) data;
 
-	state->zchild.add(String::FromCStr(key), Variant(String::FromCStr(v_utf8)));
+	hippo_bson_state_add(state, key, Variant(String::FromCStr(v_utf8)));
 	return false;
 }
 
-bool hippo_bson_visit_document(const bson_iter_t *iter __attribute__((unused)), const char *key, const bson_t *v_document, void *data)
+bool hippo_bson_visit_document(const bson_iter_t *iter, const char *key, const bson_t *v_document, void *data)
 {
 	hippo_bson_state *state = (hippo_bson_state*) data;
+	bson_iter_t child;
 	Variant document_v;
 
-	state->options.current_compound_type = HIPPO_BSONTYPE_DOCUMENT;
+	/* The view needs to own its bytes, as the buffer we are decoding from
+	 * generally does not outlive the decoded value */
+	if (state->options.document_type == HIPPO_TYPEMAP_BSONDOCUMENT) {
+		String bytes((const char*) bson_get_data(v_document), v_document->len, CopyString);
+
+		hippo_bson_state_add(state, key, Variant(createMongoBsonDocumentObject(bytes, 0, v_document->len)));
+		return false;
+	}
 
-	BsonToVariantConverter converter(bson_get_data(v_document), v_document->len, state->options);
-	converter.convert(&document_v);
+	bson_iter_recurse(iter, &child);
+	hippo_bson_decode_compound(&child, &state->options, HIPPO_BSONTYPE_DOCUMENT, &document_v);
 
-	state->zchild.add(String::FromCStr(key), document_v);
+	hippo_bson_state_add(state, key, document_v);
 
 	return false;
 }
 
-bool hippo_bson_visit_array(const bson_iter_t *iter __attribute__((unused)), const char *key, const bson_t *v_array, void *data)
+bool hippo_bson_visit_array(const bson_iter_t *iter, const char *key, const bson_t *v_array, void *data)
 {
 	hippo_bson_state *state = (hippo_bson_state*) data;
+	bson_iter_t child;
 	Variant array_v;
 
-	state->options.current_compound_type = HIPPO_BSONTYPE_ARRAY;
+	if (state->options.array_type == HIPPO_TYPEMAP_BSONPACKEDARRAY) {
+		String bytes((const char*) bson_get_data(v_array), v_array->len, CopyString);
+
+		hippo_bson_state_add(state, key, Variant(createMongoBsonPackedArrayObject(bytes, 0, v_array->len)));
+		return false;
+	}
 
-	BsonToVariantConverter converter(bson_get_data(v_array), v_array->len, state->options);
-	converter.convert(&array_v);
+	bson_iter_recurse(iter, &child);
+	hippo_bson_decode_compound(&child, &state->options, HIPPO_BSONTYPE_ARRAY, &array_v);
 
-	state->zchild.add(String::FromCStr(key), array_v);
+	hippo_bson_state_add(state, key, array_v);
 
 	return false;
 }
@@ -548,7 +973,18 @@ bool hippo_bson_visit_binary(const bson_iter_t *iter __attribute__((unused)), co
 
 	obj = createMongoBsonBinaryObject(v_binary, v_binary_len, v_subtype);
 
-	state->zchild.add(String::FromCStr(key), Variant(obj));
+	/* Remember the class name right away, so that finishing the compound
+	 * does not have to go looking for it again. The Binary object itself
+	 * is still needed, as it is part of what bsonUnserialize() gets. */
+	if (
+		v_subtype == 0x80 &&
+		state->options.current_compound_type != HIPPO_BSONTYPE_ARRAY &&
+		hippo_bson_is_pclass_key(key, strlen(key))
+	) {
+		state->pclass_name = Native::data<MongoDBBsonBinaryData>(obj.get())->m_data;
+	}
+
+	hippo_bson_state_add(state, key, Variant(obj));
 
 	return false;
 }
@@ -558,14 +994,13 @@ bool hippo_bson_visit_oid(const bson_iter_t *iter __attribute__((unused)), const
 	hippo_bson_state *state = (hippo_bson_state*) data;
 	static Class* c_objectId;
 
-	c_objectId = Unit::lookupClass(s_MongoBsonObjectID_className.get());
-	assert(c_objectId);
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_objectId, s_MongoBsonObjectID_className);
 	Object obj = Object{c_objectId};
 
 	MongoDBBsonObjectIDData* obj_data = Native::data<MongoDBBsonObjectIDData>(obj.get());
 	bson_oid_copy(v_oid, &obj_data->m_oid);
 
-	state->zchild.add(String::FromCStr(key), Variant(obj));
+	hippo_bson_state_add(state, key, Variant(obj));
 
 	return false;
 }
@@ -574,22 +1009,18 @@ bool hippo_bson_visit_bool(const bson_iter_t *iter __attribute__((unused)), cons
 {
 	hippo_bson_state *state = (hippo_bson_state*) data;
 
-	state->zchild.add(String::FromCStr(key), Variant(v_bool));
+	hippo_bson_state_add(state, key, Variant(v_bool));
 	return false;
 }
 
 bool hippo_bson_visit_date_time(const bson_iter_t *iter __attribute__((unused)), const char *key, int64_t msec_since_epoch, void *data)
 {
 	hippo_bson_state *state = (hippo_bson_state*) data;
-	static Class* c_datetime;
-
-	c_datetime = Unit::lookupClass(s_MongoBsonUTCDateTime_className.get());
-	assert(c_datetime);
-	Object obj = Object{c_datetime};
+	Object obj;
 
-	obj->o_set(s_MongoBsonUTCDateTime_milliseconds, Variant(msec_since_epoch), s_MongoBsonUTCDateTime_className);
+	obj = createMongoBsonUTCDateTimeObject(msec_since_epoch);
 
-	state->zchild.add(String::FromCStr(key), Variant(obj));
+	hippo_bson_state_add(state, key, Variant(obj));
 
 	return false;
 }
@@ -598,23 +1029,18 @@ bool hippo_bson_visit_null(const bson_iter_t *iter __attribute__((unused)), cons
 {
 	hippo_bson_state *state = (hippo_bson_state*) data;
 
-	state->zchild.add(String::FromCStr(key), Variant(Variant::NullInit()));
+	hippo_bson_state_add(state, key, Variant(Variant::NullInit()));
 	return false;
 }
 
 bool hippo_bson_visit_regex(const bson_iter_t *iter __attribute__((unused)), const char *key, const char *v_regex, const char *v_options, void *data)
 {
 	hippo_bson_state *state = (hippo_bson_state*) data;
-	static Class* c_regex;
-
-	c_regex = Unit::lookupClass(s_MongoBsonRegex_className.get());
-	assert(c_regex);
-	Object obj = Object{c_regex};
+	Object obj;
 
-	obj->o_set(s_MongoBsonRegex_pattern, Variant(v_regex), s_MongoBsonRegex_className);
-	obj->o_set(s_MongoBsonRegex_flags, Variant(v_options), s_MongoBsonRegex_className);
+	obj = createMongoBsonRegexObject(v_regex, v_options);
 
-	state->zchild.add(String::FromCStr(key), Variant(obj));
+	hippo_bson_state_add(state, key, Variant(obj));
 
 	return false;
 }
@@ -622,22 +1048,11 @@ bool hippo_bson_visit_regex(const bson_iter_t *iter __attribute__((unused)), con
 bool hippo_bson_visit_code(const bson_iter_t *iter __attribute__((unused)), const char *key, size_t v_code_len, const char *v_code, void *data)
 {
 	hippo_bson_state *state = (hippo_bson_state*) data;
-	static Class* c_code;
-	String s;
-	unsigned char *data_s;
-
-	s = String(v_code_len, ReserveString);
-	data_s = (unsigned char*) s.bufferSlice().data();
-	memcpy(data_s, v_code, v_code_len);
-	s.setSize(v_code_len);
-
-	c_code = Unit::lookupClass(s_MongoBsonJavascript_className.get());
-	assert(c_code);
-	Object obj = Object{c_code};
+	Object obj;
 
-	obj->o_set(s_MongoBsonJavascript_code, s, s_MongoBsonJavascript_className);
+	obj = createMongoBsonJavascriptObject(v_code, v_code_len, null_variant);
 
-	state->zchild.add(String::FromCStr(key), Variant(obj));
+	hippo_bson_state_add(state, key, Variant(obj));
 
 	return false;
 }
@@ -645,32 +1060,21 @@ bool hippo_bson_visit_code(const bson_iter_t *iter __attribute__((unused)), cons
 bool hippo_bson_visit_codewscope(const bson_iter_t *iter __attribute__((unused)), const char *key, size_t v_code_len, const char *v_code, const bson_t *v_scope, void *data)
 {
 	hippo_bson_state *state = (hippo_bson_state*) data;
-	static Class* c_code;
-	String s;
-	unsigned char *data_s;
+	Object obj;
+	bson_iter_t child;
 	Variant scope_v;
 
-	/* code */
-	s = String(v_code_len, ReserveString);
-	data_s = (unsigned char*) s.bufferSlice().data();
-	memcpy(data_s, v_code, v_code_len);
-	s.setSize(v_code_len);
-
 	/* scope */
-	BsonToVariantConverter converter(bson_get_data(v_scope), v_scope->len, state->options);
-	converter.convert(&scope_v);
+	if (!bson_iter_init(&child, v_scope)) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Detected corrupt BSON data");
+	}
+	hippo_bson_decode_compound(&child, &state->options, HIPPO_BSONTYPE_DOCUMENT, &scope_v);
 
 	/* create object */
-	c_code = Unit::lookupClass(s_MongoBsonJavascript_className.get());
-	assert(c_code);
-	Object obj = Object{c_code};
-
-	/* set properties */
-	obj->o_set(s_MongoBsonJavascript_code, s, s_MongoBsonJavascript_className);
-	obj->o_set(s_MongoBsonJavascript_scope, scope_v, s_MongoBsonJavascript_className);
+	obj = createMongoBsonJavascriptObject(v_code, v_code_len, scope_v);
 
 	/* add to array */
-	state->zchild.add(String::FromCStr(key), Variant(obj));
+	hippo_bson_state_add(state, key, Variant(obj));
 
 	return false;
 }
@@ -679,23 +1083,18 @@ bool hippo_bson_visit_int32(const bson_iter_t *iter __attribute__((unused)), con
 {
 	hippo_bson_state *state = (hippo_bson_state*) data;
 
-	state->zchild.add(String::FromCStr(key), Variant(v_int32));
+	hippo_bson_state_add(state, key, Variant(v_int32));
 	return false;
 }
 
 bool hippo_bson_visit_timestamp(const bson_iter_t *iter __attribute__((unused)), const char *key, uint32_t v_timestamp, uint32_t v_increment, void *data)
 {
 	hippo_bson_state *state = (hippo_bson_state*) data;
-	static Class* c_timestamp;
-
-	c_timestamp = Unit::lookupClass(s_MongoBsonTimestamp_className.get());
-	assert(c_timestamp);
-	Object obj = Object{c_timestamp};
+	Object obj;
 
-	obj->o_set(s_MongoBsonTimestamp_timestamp, Variant((uint64_t) v_timestamp), s_MongoBsonTimestamp_className);
-	obj->o_set(s_MongoBsonTimestamp_increment, Variant((uint64_t) v_increment), s_MongoBsonTimestamp_className);
+	obj = createMongoBsonTimestampObject(v_timestamp, v_increment);
 
-	state->zchild.add(String::FromCStr(key), Variant(obj));
+	hippo_bson_state_add(state, key, Variant(obj));
 
 	return false;
 }
@@ -704,7 +1103,7 @@ bool hippo_bson_visit_int64(const bson_iter_t *iter __attribute__((unused)), con
 {
 	hippo_bson_state *state = (hippo_bson_state*) data;
 
-	state->zchild.add(String::FromCStr(key), Variant(v_int64));
+	hippo_bson_state_add(state, key, Variant(v_int64));
 	return false;
 }
 
@@ -713,11 +1112,10 @@ bool hippo_bson_visit_maxkey(const bson_iter_t *iter __attribute__((unused)), co
 	hippo_bson_state *state = (hippo_bson_state*) data;
 	static Class* c_objectId;
 
-	c_objectId = Unit::lookupClass(s_MongoBsonMaxKey_className.get());
-	assert(c_objectId);
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_objectId, s_MongoBsonMaxKey_className);
 	Object obj = Object{c_objectId};
 
-	state->zchild.add(String::FromCStr(key), Variant(obj));
+	hippo_bson_state_add(state, key, Variant(obj));
 
 	return false;
 }
@@ -727,11 +1125,10 @@ bool hippo_bson_visit_minkey(const bson_iter_t *iter __attribute__((unused)), co
 	hippo_bson_state *state = (hippo_bson_state*) data;
 	static Class* c_objectId;
 
-	c_objectId = Unit::lookupClass(s_MongoBsonMinKey_className.get());
-	assert(c_objectId);
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_objectId, s_MongoBsonMinKey_className);
 	Object obj = Object{c_objectId};
 
-	state->zchild.add(String::FromCStr(key), Variant(obj));
+	hippo_bson_state_add(state, key, Variant(obj));
 
 	return false;
 }
@@ -751,14 +1148,13 @@ bool hippo_bson_visit_decimal128(const bson_iter_t *iter __attribute__((unused))
 	hippo_bson_state *state = (hippo_bson_state*) data;
 	static Class* c_decimal128;
 
-	c_decimal128 = Unit::lookupClass(s_MongoBsonDecimal128_className.get());
-	assert(c_decimal128);
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_decimal128, s_MongoBsonDecimal128_className);
 	Object obj = Object{c_decimal128};
 
 	MongoDBBsonDecimal128Data* obj_data = Native::data<MongoDBBsonDecimal128Data>(obj);
 	memcpy(&obj_data->m_decimal, v_decimal128, sizeof(bson_decimal128_t));
 
-	state->zchild.add(String::FromCStr(key), Variant(obj));
+	hippo_bson_state_add(state, key, Variant(obj));
 
 	return false;
 }
@@ -792,58 +1188,183 @@ static const bson_visitor_t hippo_bson_visitors = {
 	hippo_bson_visit_decimal128,
 	{ NULL }
 };
+
+/* Runs the visitor for the one element that 'iter' points at, for callers
+ * that walk through a document themselves instead of with
+ * bson_iter_visit_all(). Types without a visitor are skipped. */
+bool hippo_bson_visit_one(const bson_iter_t *iter, hippo_bson_state *state)
+{
+	const char *key = bson_iter_key(iter);
+	bson_t child;
+	const uint8_t *child_data = NULL;
+	uint32_t child_len = 0;
+
+	switch (bson_iter_type(iter)) {
+		case BSON_TYPE_DOUBLE:
+			return hippo_bson_visit_double(iter, key, bson_iter_double(iter), state);
+
+		case BSON_TYPE_UTF8: {
+			uint32_t v_utf8_len;
+			const char *v_utf8 = bson_iter_utf8(iter, &v_utf8_len);
+
+			if (!bson_utf8_validate(v_utf8, v_utf8_len, true)) {
+				break;
+			}
+			return hippo_bson_visit_utf8(iter, key, v_utf8_len, v_utf8, state);
+		}
+
+		case BSON_TYPE_DOCUMENT:
+			bson_iter_document(iter, &child_len, &child_data);
+			if (!child_data || !bson_init_static(&child, child_data, child_len)) {
+				break;
+			}
+			return hippo_bson_visit_document(iter, key, &child, state);
+
+		case BSON_TYPE_ARRAY:
+			bson_iter_array(iter, &child_len, &child_data);
+			if (!child_data || !bson_init_static(&child, child_data, child_len)) {
+				break;
+			}
+			return hippo_bson_visit_array(iter, key, &child, state);
+
+		case BSON_TYPE_BINARY: {
+			bson_subtype_t v_subtype;
+			uint32_t v_binary_len;
+			const uint8_t *v_binary;
+
+			bson_iter_binary(iter, &v_subtype, &v_binary_len, &v_binary);
+			return hippo_bson_visit_binary(iter, key, v_subtype, v_binary_len, v_binary, state);
+		}
+
+		case BSON_TYPE_OID:
+			return hippo_bson_visit_oid(iter, key, bson_iter_oid(iter), state);
+
+		case BSON_TYPE_BOOL:
+			return hippo_bson_visit_bool(iter, key, bson_iter_bool(iter), state);
+
+		case BSON_TYPE_DATE_TIME:
+			return hippo_bson_visit_date_time(iter, key, bson_iter_date_time(iter), state);
+
+		case BSON_TYPE_NULL:
+			return hippo_bson_visit_null(iter, key, state);
+
+		case BSON_TYPE_REGEX: {
+			const char *v_options;
+			const char *v_regex = bson_iter_regex(iter, &v_options);
+
+			return hippo_bson_visit_regex(iter, key, v_regex, v_options, state);
+		}
+
+		case BSON_TYPE_CODE: {
+			uint32_t v_code_len;
+			const char *v_code = bson_iter_code(iter, &v_code_len);
+
+			return hippo_bson_visit_code(iter, key, v_code_len, v_code, state);
+		}
+
+		case BSON_TYPE_CODEWSCOPE: {
+			uint32_t v_code_len;
+			const char *v_code = bson_iter_codewscope(iter, &v_code_len, &child_len, &child_data);
+
+			if (!child_data || !bson_init_static(&child, child_data, child_len)) {
+				break;
+			}
+			return hippo_bson_visit_codewscope(iter, key, v_code_len, v_code, &child, state);
+		}
+
+		case BSON_TYPE_INT32:
+			return hippo_bson_visit_int32(iter, key, bson_iter_int32(iter), state);
+
+		case BSON_TYPE_TIMESTAMP: {
+			uint32_t v_timestamp;
+			uint32_t v_increment;
+
+			bson_iter_timestamp(iter, &v_timestamp, &v_increment);
+			return hippo_bson_visit_timestamp(iter, key, v_timestamp, v_increment, state);
+		}
+
+		case BSON_TYPE_INT64:
+			return hippo_bson_visit_int64(iter, key, bson_iter_int64(iter), state);
+
+		case BSON_TYPE_MAXKEY:
+			return hippo_bson_visit_maxkey(iter, key, state);
+
+		case BSON_TYPE_MINKEY:
+			return hippo_bson_visit_minkey(iter, key, state);
+
+		case BSON_TYPE_DECIMAL128: {
+			bson_decimal128_t v_decimal128;
+
+			bson_iter_decimal128(iter, &v_decimal128);
+			return hippo_bson_visit_decimal128(iter, key, &v_decimal128, state);
+		}
+
+		case BSON_TYPE_UNDEFINED:
+		case BSON_TYPE_DBPOINTER:
+		case BSON_TYPE_SYMBOL:
+			return false;
+
+		default:
+			hippo_bson_visit_unsupported_type(iter, key, bson_iter_type(iter), state);
+			return false;
+	}
+
+	hippo_bson_visit_corrupt(iter, state);
+	return true;
+}
 /* }}} */
 
 
-bool BsonToVariantConverter::convert(Variant *v)
+static void hippo_bson_call_unserialize(const Object &obj, const Func *m, const Array &data)
+{
+	Variant result;
+	Variant arg(data);
+	TypedValue args[1] = { *arg.asCell() };
+
+	g_context->invokeFuncFew(
+		result.asTypedValue(),
+		m,
+		obj.get(),
+		nullptr,
+		1, args
+	);
+}
+
+/* Turns the elements collected in 'state' into an array or object, as
+ * dictated by the type map and an optional __pclass field */
+/* When __pclass did not give the document its class, it is just another
+ * field, which must not show up if the projection didn't ask for it */
+static void hippo_bson_drop_unprojected_pclass(hippo_bson_state *state)
 {
-	bson_iter_t   iter;
-	bool          eof = false;
-	bool          havePclass;
-	const bson_t *b;
+	if (state->pclass_unprojected) {
+		state->zchild.remove(s_MongoDriverBsonODM_fieldName);
+	}
+}
+
+static void hippo_bson_finish_compound(hippo_bson_state *state, Variant *v)
+{
+	bool havePclass;
 	int type_descriminator;
 	String named_class;
 
-	m_state.zchild = NULL;
-
 	/* Determine which descriminator to use */
-	switch (m_options.current_compound_type) {
+	switch (state->options.current_compound_type) {
 		case HIPPO_BSONTYPE_ARRAY:
-			type_descriminator = m_options.array_type;
-			named_class = m_options.array_class_name;
+			type_descriminator = state->options.array_type;
+			named_class = state->options.array_class_name;
 			break;
 
 		case HIPPO_BSONTYPE_ROOT:
-			type_descriminator = m_options.root_type;
-			named_class = m_options.root_class_name;
+			type_descriminator = state->options.root_type;
+			named_class = state->options.root_class_name;
 			break;
 
 		case HIPPO_BSONTYPE_DOCUMENT:
-			type_descriminator = m_options.document_type;
-			named_class = m_options.document_class_name;
+			type_descriminator = state->options.document_type;
+			named_class = state->options.document_class_name;
 			break;
 	}
 
-	if (!(b = bson_reader_read(m_reader, &eof))) {
-		throw MongoDriver::Utils::throwUnexpectedValueException("Could not read document from BSON reader");
-		return false;
-	}
-
-	if (!bson_iter_init(&iter, b)) {
-		bson_reader_destroy(m_reader);
-		throw MongoDriver::Utils::throwUnexpectedValueException("Could not initialize BSON iterator");
-		return false;
-	}
-
-	m_state.zchild = Array::Create();
-	m_state.options = m_options;
-
-	if (bson_iter_visit_all(&iter, &hippo_bson_visitors, &m_state) || iter.err_off) {
-		bson_reader_destroy(m_reader);
-
-		throw MongoDriver::Utils::throwUnexpectedValueException("Detected corrupt BSON data");
-	}
-
 	/* Set "root" to false */
 	havePclass = false;
 
@@ -852,35 +1373,25 @@ bool BsonToVariantConverter::convert(Variant *v)
 			type_descriminator == HIPPO_TYPEMAP_DEFAULT ||
 			type_descriminator == HIPPO_TYPEMAP_NAMEDCLASS
 		) &&
-		m_state.zchild.exists(s_MongoDriverBsonODM_fieldName) &&
-		m_state.zchild[s_MongoDriverBsonODM_fieldName].isObject() &&
-		m_state.zchild[s_MongoDriverBsonODM_fieldName].toObject().instanceof(s_MongoBsonBinary_className) &&
-		m_state.zchild[s_MongoDriverBsonODM_fieldName].toObject().o_get(s_MongoBsonBinary_type, false, s_MongoBsonBinary_className).toInt64() == 0x80
+		!state->pclass_name.isNull()
 	) {
 		havePclass = true;
+	} else {
+		hippo_bson_drop_unprojected_pclass(state);
 	}
 
 	if (type_descriminator == HIPPO_TYPEMAP_NAMEDCLASS) {
-		static Class* c_class;
-		static Class* c_unserializable_interface;
-		static Class* c_persistable_interface;
+		Class* c_class;
 		Object obj;
-		Variant result;
 		bool useTypeMap = true;
-		c_unserializable_interface = Unit::lookupClass(s_MongoDriverBsonUnserializable_className.get());
-		c_persistable_interface = Unit::lookupClass(s_MongoDriverBsonPersistable_className.get());
 
 		/* If we have a __pclass, and the class exists, and the class
 		 * implements MongoDB\BSON\Persitable, we use that class name. */
 		if (havePclass) {
-			String class_name = m_state.zchild[s_MongoDriverBsonODM_fieldName].toObject().o_get(
-				s_MongoBsonBinary_data, false, s_MongoBsonBinary_className
-			).toString();
-
 			/* Lookup class and instantiate object, but if we can't find the class,
 			 * make it a stdClass */
-			c_class = Unit::getClass(class_name.get(), true);
-			if (c_class && isNormalClass(c_class) && c_class->classof(c_persistable_interface)) {
+			c_class = hippo_bson_lookup_pclass(state->pclass_name);
+			if (c_class && isNormalClass(c_class) && hippo_bson_get_class_info(c_class)->is_persistable) {
 				/* Instantiate */
 				obj = Object{c_class};
 				useTypeMap = false;
@@ -889,8 +1400,10 @@ bool BsonToVariantConverter::convert(Variant *v)
 		}
 
 		if (useTypeMap) {
-			c_class = Unit::getClass(named_class.get(), true);
-			if (c_class && isNormalClass(c_class) && c_class->classof(c_unserializable_interface)) {
+			hippo_bson_drop_unprojected_pclass(state);
+
+			c_class = hippo_bson_lookup_pclass(named_class);
+			if (c_class && isNormalClass(c_class) && hippo_bson_get_class_info(c_class)->is_unserializable) {
 				/* Instantiate */
 				obj = Object{c_class};
 				useTypeMap = false;
@@ -903,90 +1416,276 @@ bool BsonToVariantConverter::convert(Variant *v)
 			throw MongoDriver::Utils::throwInvalidArgumentException("The typemap does not provide a class that implements MongoDB\\BSON\\Unserializable");
 		}
 
-		{
-			/* Setup arguments for bsonUnserialize call */
-			TypedValue args[1] = { *(Variant(m_state.zchild)).asCell() };
-
-			/* Call bsonUnserialize on the object */
-			Func *m = c_class->lookupMethod(s_MongoDriverBsonUnserializable_functionName.get());
-
-			g_context->invokeFuncFew(
-				result.asTypedValue(),
-				m,
-				obj.get(),
-				nullptr,
-				1, args
-			);
-
-			*v = Variant(obj);
-		}
+		hippo_bson_call_unserialize(obj, hippo_bson_get_class_info(c_class)->unserialize_func, state->zchild);
+		*v = Variant(obj);
 	} else if (havePclass) {
-		static Class* c_class;
-		Variant result;
-
-		String class_name = m_state.zchild[s_MongoDriverBsonODM_fieldName].toObject().o_get(
-			s_MongoBsonBinary_data, false, s_MongoBsonBinary_className
-		).toString();
-		TypedValue args[1] = { *(Variant(m_state.zchild)).asCell() };
+		Class* c_class;
 
 		/* Lookup class and instantiate object, but if we can't find the class,
 		 * make it a stdClass */
-		c_class = Unit::getClass(class_name.get(), true);
+		c_class = hippo_bson_lookup_pclass(state->pclass_name);
 		if (!c_class) {
-			*v = Variant(Variant(m_state.zchild).toObject());
-			return true;
+			hippo_bson_drop_unprojected_pclass(state);
+			*v = Variant(Variant(state->zchild).toObject());
+			return;
 		}
 
 		/* If the class is not a "normal" class, make it a stdClass object */
 		if (!isNormalClass(c_class) || isAbstract(c_class)) {
-			*v = Variant(Variant(m_state.zchild).toObject());
-			return true;
+			hippo_bson_drop_unprojected_pclass(state);
+			*v = Variant(Variant(state->zchild).toObject());
+			return;
 		}
 
-		/* Instantiate */
-		Object obj = Object{c_class};
-
 		/* If the class does not implement Persistable, make it a stdClass */
-		if (!obj->instanceof(s_MongoDriverBsonPersistable_className)) {
-			*v = Variant(Variant(m_state.zchild).toObject());
-			return true;
-		}
+		hippo_bson_class_info_t *info = hippo_bson_get_class_info(c_class);
 
-		/* Call bsonUnserialize on the object */
-		Func *m = c_class->lookupMethod(s_MongoDriverBsonUnserializable_functionName.get());
+		if (!info->is_persistable) {
+			hippo_bson_drop_unprojected_pclass(state);
+			*v = Variant(Variant(state->zchild).toObject());
+			return;
+		}
 
-		g_context->invokeFuncFew(
-			result.asTypedValue(),
-			m,
-			obj.get(),
-			nullptr,
-			1, args
-		);
+		/* Instantiate */
+		Object obj = Object{c_class};
 
+		hippo_bson_call_unserialize(obj, info->unserialize_func, state->zchild);
 		*v = Variant(obj);
 	} else if (type_descriminator == HIPPO_TYPEMAP_DEFAULT) {
-		if (m_options.current_compound_type == HIPPO_BSONTYPE_ARRAY) {
-			*v = Variant(Variant(m_state.zchild).toArray());
-		} else if (m_options.current_compound_type == HIPPO_BSONTYPE_ROOT) {
-			*v = Variant(Variant(m_state.zchild).toObject());
-		} else if (m_options.current_compound_type == HIPPO_BSONTYPE_DOCUMENT) {
-			*v = Variant(Variant(m_state.zchild).toObject());
+		if (state->options.current_compound_type == HIPPO_BSONTYPE_ARRAY) {
+			*v = Variant(Variant(state->zchild).toArray());
+		} else if (state->options.current_compound_type == HIPPO_BSONTYPE_ROOT) {
+			*v = Variant(Variant(state->zchild).toObject());
+		} else if (state->options.current_compound_type == HIPPO_BSONTYPE_DOCUMENT) {
+			*v = Variant(Variant(state->zchild).toObject());
 		}
 	} else if (type_descriminator == HIPPO_TYPEMAP_STDCLASS) {
-		*v = Variant(Variant(m_state.zchild).toObject());
+		*v = Variant(Variant(state->zchild).toObject());
 	} else if (type_descriminator == HIPPO_TYPEMAP_ARRAY) {
-		*v = Variant(m_state.zchild);
+		*v = Variant(state->zchild);
 	} else {
 		assert(NULL);
 	}
+}
+
+/* {{{ Projection */
+static const hippo_bson_projection_t *hippo_bson_projection_find(const hippo_bson_projection_t *projection, const char *key)
+{
+	for (const hippo_bson_projection_t &child : projection->children) {
+		if (strcmp(child.name.c_str(), key) == 0) {
+			return &child;
+		}
+	}
+
+	return NULL;
+}
+
+/* Visits only the elements named by the projection, handing each of them the
+ * part of the projection that applies to its own children. Unless the type
+ * map rules it out, the "__pclass" field is visited too, so that the class
+ * can still be determined; otherwise we stop as soon as every projected
+ * field has been seen. */
+static void hippo_bson_visit_projected(bson_iter_t *iter, hippo_bson_state *state)
+{
+	std::shared_ptr<const hippo_bson_projection_t> projection = state->options.projection;
+	size_t remaining = projection->children.size();
+	std::vector<bool> seen(projection->children.size(), false);
+	int type = state->options.current_compound_type == HIPPO_BSONTYPE_ROOT ? state->options.root_type : state->options.document_type;
+	bool want_pclass = type == HIPPO_TYPEMAP_DEFAULT || type == HIPPO_TYPEMAP_NAMEDCLASS;
+
+	while ((remaining || want_pclass) && bson_iter_next(iter)) {
+		const char *key = bson_iter_key(iter);
+		const hippo_bson_projection_t *child = hippo_bson_projection_find(projection.get(), key);
+
+		if (child) {
+			/* Duplicate keys must not count twice towards the early exit */
+			size_t index = child - projection->children.data();
+
+			if (!seen[index]) {
+				seen[index] = true;
+				remaining--;
+			}
+
+			if (child->whole) {
+				state->options.projection = nullptr;
+			} else {
+				state->options.projection = std::shared_ptr<const hippo_bson_projection_t>(projection, child);
+			}
+		} else if (want_pclass && strcmp(key, s_MongoDriverBsonODM_fieldName.data()) == 0) {
+			state->options.projection = nullptr;
+			state->pclass_unprojected = true;
+		} else {
+			continue;
+		}
+
+		if (hippo_bson_visit_one(iter, state)) {
+			state->options.projection = projection;
+			throw MongoDriver::Utils::throwUnexpectedValueException("Detected corrupt BSON data");
+		}
+	}
+
+	state->options.projection = projection;
 
-	if (bson_reader_read(m_reader, &eof) || !eof) {
-		bson_reader_destroy(m_reader);
+	if (iter->err_off) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Detected corrupt BSON data");
+	}
+}
+/* }}} */
+
+/* {{{ Hydration
+ *
+ * With the 'hydrate' type map option, documents that would be handed to
+ * bsonUnserialize() are instead written straight into the properties of a
+ * new instance of the class: declared properties (including protected and
+ * private ones, also those of parent classes) are set in their slots, and
+ * other fields become dynamic properties. Neither bsonUnserialize(), the
+ * constructor, nor __set() is called. Returns NULL if the document does not
+ * map onto a class. */
+static Class *hippo_bson_hydration_class(const bson_iter_t *iter, const hippo_bson_state *state)
+{
+	bson_iter_t scan = *iter;
+	int type_descriminator;
+	const String *named_class;
+	Class *c_class;
+
+	if (state->options.current_compound_type == HIPPO_BSONTYPE_ROOT) {
+		type_descriminator = state->options.root_type;
+		named_class = &state->options.root_class_name;
+	} else {
+		type_descriminator = state->options.document_type;
+		named_class = &state->options.document_class_name;
+	}
+
+	if (type_descriminator != HIPPO_TYPEMAP_DEFAULT && type_descriminator != HIPPO_TYPEMAP_NAMEDCLASS) {
+		return NULL;
+	}
+
+	/* A Persistable __pclass takes precedence over the type map, just like
+	 * it does in hippo_bson_finish_compound() */
+	if (bson_iter_find(&scan, s_MongoDriverBsonODM_fieldName.data()) && BSON_ITER_HOLDS_BINARY(&scan)) {
+		bson_subtype_t subtype;
+		uint32_t len;
+		const uint8_t *class_name;
+
+		bson_iter_binary(&scan, &subtype, &len, &class_name);
+
+		if (subtype == 0x80) {
+			c_class = hippo_bson_lookup_pclass(String((const char*) class_name, len, CopyString));
+
+			if (c_class && isNormalClass(c_class) && !isAbstract(c_class) && hippo_bson_get_class_info(c_class)->is_persistable) {
+				return c_class;
+			}
+		}
+	}
+
+	if (type_descriminator == HIPPO_TYPEMAP_NAMEDCLASS) {
+		c_class = hippo_bson_lookup_pclass(*named_class);
+
+		if (c_class && isNormalClass(c_class) && hippo_bson_get_class_info(c_class)->is_unserializable) {
+			return c_class;
+		}
+	}
+
+	return NULL;
+}
+/* }}} */
+
+/* Elements of an array are not filtered by a projection, but the projection
+ * does apply to each of the documents inside of it, as it does on the
+ * server */
+static void hippo_bson_decode_compound(bson_iter_t *iter, const hippo_bson_conversion_options_t *options, int compound_type, Variant *v)
+{
+	hippo_bson_state state;
+
+	/* Most views are made in the document and array visitors already, but
+	 * the scope of a Javascript and PackedArray::toPHP() come through here.
+	 * 'iter' has not moved yet, so it still spans the whole compound. */
+	if (compound_type == HIPPO_BSONTYPE_DOCUMENT && options->document_type == HIPPO_TYPEMAP_BSONDOCUMENT) {
+		*v = Variant(createMongoBsonDocumentObject(String((const char*) iter->raw, iter->len, CopyString), 0, iter->len));
+		return;
+	}
+	if (compound_type == HIPPO_BSONTYPE_ARRAY && options->array_type == HIPPO_TYPEMAP_BSONPACKEDARRAY) {
+		*v = Variant(createMongoBsonPackedArrayObject(String((const char*) iter->raw, iter->len, CopyString), 0, iter->len));
+		return;
+	}
+
+	if (compound_type == HIPPO_BSONTYPE_ARRAY) {
+		bson_iter_t count_iter = *iter;
+		uint32_t count = 0;
+
+		while (bson_iter_next(&count_iter)) {
+			count++;
+		}
+
+		state.zchild = Array::attach(PackedArray::MakeReserve(count));
+	} else {
+		state.zchild = Array::Create();
+	}
+	state.options = *options;
+	state.options.current_compound_type = compound_type;
+
+	if (state.options.hydrate && compound_type != HIPPO_BSONTYPE_ARRAY) {
+		Class *c_class = hippo_bson_hydration_class(iter, &state);
+
+		if (c_class) {
+			state.object = Object{c_class};
+			state.object_slots = hippo_bson_get_hydrate_slots(c_class);
+		}
+	}
+
+	if (state.options.projection && compound_type != HIPPO_BSONTYPE_ARRAY) {
+		hippo_bson_visit_projected(iter, &state);
+	} else if (bson_iter_visit_all(iter, &hippo_bson_visitors, &state) || iter->err_off) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Detected corrupt BSON data");
+	}
+
+	if (!state.object.isNull()) {
+		*v = Variant(state.object);
+		return;
+	}
+
+	hippo_bson_finish_compound(&state, v);
+}
+
+/* Embedded documents and arrays are decoded by recursing into the same
+ * buffer with bson_iter_recurse(), so only the root document is checked
+ * against the length of the input buffer */
+bool BsonToVariantConverter::convert(Variant *v)
+{
+	bson_iter_t iter;
+	bson_t      b;
+	uint32_t    len_le;
+	uint32_t    len = 0;
+
+	if (m_data_len >= 5) {
+		memcpy(&len_le, m_data, sizeof(len_le));
+		len = BSON_UINT32_FROM_LE(len_le);
+	}
+
+	if (len < 5 || len > (uint32_t) m_data_len || !bson_init_static(&b, m_data, len)) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Could not read document from BSON reader");
+		return false;
+	}
+
+	if (!bson_iter_init(&iter, &b)) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Could not initialize BSON iterator");
+		return false;
+	}
+
+	if (m_options.current_compound_type == HIPPO_BSONTYPE_ROOT && m_options.root_type == HIPPO_TYPEMAP_BSONDOCUMENT) {
+		*v = Variant(createMongoBsonDocumentObject(String((const char*) m_data, len, CopyString), 0, len));
+	} else if (m_options.current_compound_type == HIPPO_BSONTYPE_ROOT && m_options.root_type == HIPPO_TYPEMAP_BSON) {
+		/* Passed through as-is, for callers that only hand documents on */
+		*v = Variant(String((const char*) m_data, len, CopyString));
+	} else {
+		hippo_bson_decode_compound(&iter, &m_options, m_options.current_compound_type, v);
+	}
+
+	if (len != (uint32_t) m_data_len) {
 		throw MongoDriver::Utils::throwUnexpectedValueException("Reading document did not exhaust input buffer");
 		return false;
 	}
 
-	bson_reader_destroy(m_reader);
 	return true;
 }
 /* }}} */
@@ -1012,6 +1711,72 @@ static void validateClass(String class_name)
 	}
 }
 
+/* Adds a dotted field path to the projection tree. A path that is a prefix of
+ * another one wins, as it already includes everything below it. */
+static void hippo_bson_projection_add(hippo_bson_projection_t *node, const char *path, size_t path_len)
+{
+	const char *dot = (const char*) memchr(path, '.', path_len);
+	size_t name_len = dot ? (size_t) (dot - path) : path_len;
+	hippo_bson_projection_t *child = NULL;
+
+	if (name_len == 0 || (dot && name_len == path_len - 1)) {
+		throw MongoDriver::Utils::throwInvalidArgumentException("Projection field paths can not contain empty field names");
+	}
+
+	for (hippo_bson_projection_t &existing : node->children) {
+		if (existing.name.size() == name_len && memcmp(existing.name.data(), path, name_len) == 0) {
+			child = &existing;
+			break;
+		}
+	}
+
+	if (!child) {
+		node->children.push_back(hippo_bson_projection_t());
+		child = &node->children.back();
+		child->name = std::string(path, name_len);
+		child->whole = false;
+	} else if (child->whole) {
+		return;
+	}
+
+	if (!dot) {
+		child->whole = true;
+		child->children.clear();
+		return;
+	}
+
+	hippo_bson_projection_add(child, dot + 1, path_len - name_len - 1);
+}
+
+static void parseProjection(hippo_bson_conversion_options_t *options, const Variant &paths)
+{
+	std::shared_ptr<hippo_bson_projection_t> projection;
+
+	if (!paths.isArray()) {
+		throw MongoDriver::Utils::throwInvalidArgumentException("The 'projection' type map option must be an array of field paths");
+	}
+
+	projection = std::make_shared<hippo_bson_projection_t>();
+	projection->whole = false;
+
+	for (ArrayIter iter(paths.toArray()); iter; ++iter) {
+		const Variant &path = iter.secondRef();
+
+		if (!path.isString()) {
+			throw MongoDriver::Utils::throwInvalidArgumentException("The 'projection' type map option must be an array of field paths");
+		}
+
+		hippo_bson_projection_add(projection.get(), path.toString().data(), path.toString().size());
+	}
+
+	/* An empty list means that no projection is applied at all */
+	if (projection->children.empty()) {
+		options->projection = nullptr;
+	} else {
+		options->projection = projection;
+	}
+}
+
 void parseTypeMap(hippo_bson_conversion_options_t *options, const Array &typemap)
 {
 	if (typemap.exists(s_root) && typemap[s_root].isString()) {
@@ -1023,6 +1788,10 @@ void parseTypeMap(hippo_bson_conversion_options_t *options, const Array &typemap
 			options->root_type = HIPPO_TYPEMAP_STDCLASS;
 		} else if (CASECMP(root_type, s_array)) {
 			options->root_type = HIPPO_TYPEMAP_ARRAY;
+		} else if (CASECMP(root_type, s_bsonDocument)) {
+			options->root_type = HIPPO_TYPEMAP_BSONDOCUMENT;
+		} else if (CASECMP(root_type, s_bson)) {
+			options->root_type = HIPPO_TYPEMAP_BSON;
 		} else {
 			validateClass(root_type); /* Might throw an exception */
 
@@ -1040,6 +1809,8 @@ void parseTypeMap(hippo_bson_conversion_options_t *options, const Array &typemap
 			options->document_type = HIPPO_TYPEMAP_STDCLASS;
 		} else if (CASECMP(document_type, s_array)) {
 			options->document_type = HIPPO_TYPEMAP_ARRAY;
+		} else if (CASECMP(document_type, s_bsonDocument)) {
+			options->document_type = HIPPO_TYPEMAP_BSONDOCUMENT;
 		} else {
 			validateClass(document_type); /* Might throw an exception */
 
@@ -1057,6 +1828,8 @@ void parseTypeMap(hippo_bson_conversion_options_t *options, const Array &typemap
 			options->array_type = HIPPO_TYPEMAP_STDCLASS;
 		} else if (CASECMP(array_type, s_array)) {
 			options->array_type = HIPPO_TYPEMAP_ARRAY;
+		} else if (CASECMP(array_type, s_bsonPackedArray)) {
+			options->array_type = HIPPO_TYPEMAP_BSONPACKEDARRAY;
 		} else {
 			validateClass(array_type); /* Might throw an exception */
 
@@ -1064,6 +1837,14 @@ void parseTypeMap(hippo_bson_conversion_options_t *options, const Array &typemap
 			options->array_class_name = array_type;
 		}
 	}
+
+	if (typemap.exists(s_projection)) {
+		parseProjection(options, typemap[s_projection]);
+	}
+
+	if (typemap.exists(s_hydrate)) {
+		options->hydrate = typemap[s_hydrate].toBoolean();
+	}
 }
 
 /* }}} */
@@ -18,6 +18,11 @@
 
 #include "hphp/runtime/ext/extension.h"
 
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 extern "C" {
 #include "libbson/src/bson/bson.h"
 }
@@ -34,11 +39,31 @@ namespace HPHP {
 #define HIPPO_TYPEMAP_STDCLASS   0x04
 #define HIPPO_TYPEMAP_ARRAY      0x05
 #define HIPPO_TYPEMAP_NAMEDCLASS 0x06
+#define HIPPO_TYPEMAP_BSONDOCUMENT    0x07
+#define HIPPO_TYPEMAP_BSONPACKEDARRAY 0x08
+#define HIPPO_TYPEMAP_BSON            0x09 /* root only: the raw document */
 
 #define HIPPO_BSONTYPE_ARRAY     0x10
 #define HIPPO_BSONTYPE_DOCUMENT  0x11
 #define HIPPO_BSONTYPE_ROOT      0x12
 
+/* This is not a bitfield */
+#define HIPPO_BSON_ENCODE_DOCUMENT       0x01
+#define HIPPO_BSON_ENCODE_SERIALIZABLE   0x02
+#define HIPPO_BSON_ENCODE_PERSISTABLE    0x03
+#define HIPPO_BSON_ENCODE_BINARY         0x04
+#define HIPPO_BSON_ENCODE_DECIMAL128     0x05
+#define HIPPO_BSON_ENCODE_JAVASCRIPT     0x06
+#define HIPPO_BSON_ENCODE_MAXKEY         0x07
+#define HIPPO_BSON_ENCODE_MINKEY         0x08
+#define HIPPO_BSON_ENCODE_OBJECTID       0x09
+#define HIPPO_BSON_ENCODE_REGEX          0x0a
+#define HIPPO_BSON_ENCODE_TIMESTAMP      0x0b
+#define HIPPO_BSON_ENCODE_UTCDATETIME    0x0c
+#define HIPPO_BSON_ENCODE_UNKNOWN_TYPE   0x0d
+#define HIPPO_BSON_ENCODE_BSONDOCUMENT    0x0e
+#define HIPPO_BSON_ENCODE_BSONPACKEDARRAY 0x0f
+
 #define HIPPO_TYPEMAP_INITIALIZER { HIPPO_TYPEMAP_DEFAULT, HIPPO_TYPEMAP_DEFAULT, HIPPO_TYPEMAP_DEFAULT, HIPPO_BSONTYPE_ROOT }
 #define HIPPO_TYPEMAP_DEBUG_INITIALIZER { HIPPO_TYPEMAP_ARRAY, HIPPO_TYPEMAP_ARRAY, HIPPO_TYPEMAP_ARRAY, HIPPO_BSONTYPE_ROOT }
 
@@ -58,8 +83,14 @@ class VariantToBsonConverter
 		int m_flags;
 /* }}} */
 /* private methods {{{ */
-		int _isPackedArray(const Array &a);
-		char *_getUnmangledPropertyName(String key);
+		const char *_getUnmangledPropertyName(const char *key, size_t key_len);
+		void _checkForId(const char *key, size_t key_len, const Variant &data);
+		void _convertKeyedElement(bson_t *bson, const char *key, size_t key_len, const Variant &data, bool unmangle);
+		void _convertArrayElements(bson_t *bson, const ArrayData *ad, bool unmangle, bool skip_pclass);
+		void _convertPackedArrayElements(bson_t *bson, const ArrayData *ad);
+		void _convertObjectProperties(bson_t *bson, ObjectData *obj, bool skip_pclass);
+		void _convertDocument(bson_t *bson, const char *property_name, const Variant &v, bool is_array, const Class *pclass);
+		void _appendId(bson_t *bson);
 		void _convertBinary(bson_t *bson, const char *key, Object v);
 		void _convertDecimal128(bson_t *bson, const char *key, Object v);
 		void _convertJavascript(bson_t *bson, const char *key, Object v);
@@ -69,21 +100,32 @@ class VariantToBsonConverter
 		void _convertRegex(bson_t *bson, const char *key, Object v);
 		void _convertTimestamp(bson_t *bson, const char *key, Object v);
 		void _convertUTCDateTime(bson_t *bson, const char *key, Object v);
+		void _convertBsonDocument(bson_t *bson, const char *key, Object v);
+		void _convertBsonPackedArray(bson_t *bson, const char *key, Object v);
 
-		void _convertSerializable(bson_t *bson, const char *key, Object v);
+		void _convertSerializable(bson_t *bson, const char *key, Object v, bool persistable);
 
-		void convertDocument(bson_t *bson, const char *key, Variant v);
-		void convertElement(bson_t *bson, const char *key, Variant v);
+		void convertDocument(bson_t *bson, const char *key, const Variant &v);
+		void convertElement(bson_t *bson, const char *key, const Variant &v);
 		bool convertSpecialObject(bson_t *bson, const char *key, Object v);
 
 		void convertNull(bson_t *bson, const char *key);
 		void convertBoolean(bson_t *bson, const char *key, bool v);
 		void convertInt64(bson_t *bson, const char *key, int64_t v);
 		void convertDouble(bson_t *bson, const char *key, double v);
-		void convertString(bson_t *bson, const char *key, String v);
+		void convertString(bson_t *bson, const char *key, const String &v);
 /* }}} */
 };
 
+/* A node in the tree of field paths from the 'projection' type map option.
+ * A 'whole' node includes the field with everything in it; otherwise only
+ * the listed children of an embedded document are included. */
+typedef struct hippo_bson_projection {
+	std::string name;
+	bool whole;
+	std::vector<struct hippo_bson_projection> children;
+} hippo_bson_projection_t;
+
 typedef struct {
 	int array_type;
 	int root_type;
@@ -92,11 +134,17 @@ typedef struct {
 	String array_class_name;
 	String root_class_name;
 	String document_class_name;
+	std::shared_ptr<const hippo_bson_projection_t> projection;
+	bool hydrate;
 } hippo_bson_conversion_options_t;
 
 typedef struct {
 	Array zchild;
 	hippo_bson_conversion_options_t options;
+	String pclass_name; /* set by the binary visitor when it sees __pclass */
+	bool pclass_unprojected = false; /* __pclass was only decoded to find the class */
+	Object object;      /* when hydrating, elements are set on this object instead */
+	const std::unordered_map<std::string, Slot> *object_slots; /* property name → slot of the object's class */
 } hippo_bson_state;
 
 class BsonToVariantConverter
@@ -105,12 +153,24 @@ class BsonToVariantConverter
 		BsonToVariantConverter(const unsigned char *data, int data_len, hippo_bson_conversion_options_t options);
 		bool convert(Variant *v);
 	private:
-		bson_reader_t *m_reader;
+		const unsigned char *m_data;
+		int m_data_len;
 
-		hippo_bson_state m_state;
 		hippo_bson_conversion_options_t m_options;
 };
 
+bool hippo_bson_visit_one(const bson_iter_t *iter, hippo_bson_state *state);
+
+/* {{{ Per-request caches */
+void hippo_bson_cache_reset();
+/* }}} */
+
+#ifndef NDEBUG
+/* Allocations made for keys by VariantToBsonConverter on this thread, which
+ * stays at 0 as long as only plain arrays and objects are encoded */
+size_t hippo_bson_key_allocations();
+#endif
+
 /* {{{ TypeMap helper functions */
 void parseTypeMap(hippo_bson_conversion_options_t *options, const Array &typemap);
 /* }}} */
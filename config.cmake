@@ -2,10 +2,14 @@ HHVM_EXTENSION(mongodb
  mongodb.cpp
  bson.cpp pool.cpp utils.cpp
  src/MongoDB/BSON/functions.cpp
+ src/MongoDB/BSON/extjson.cpp
  src/MongoDB/BSON/Binary.cpp
  src/MongoDB/BSON/Decimal128.cpp
+ src/MongoDB/BSON/Document.cpp
+ src/MongoDB/BSON/DocumentReader.cpp
  src/MongoDB/BSON/Javascript.cpp
  src/MongoDB/BSON/ObjectID.cpp
+ src/MongoDB/BSON/PackedArray.cpp
  src/MongoDB/BSON/Regex.cpp
  src/MongoDB/BSON/Timestamp.cpp
  src/MongoDB/BSON/UTCDateTime.cpp
@@ -56,8 +60,10 @@ HHVM_EXTENSION(mongodb
  libmongoc/src/mongoc/mongoc-gridfs-file-list.c
  libmongoc/src/mongoc/mongoc-gridfs-file-page.c
  libmongoc/src/mongoc/mongoc-gridfs-file.c libmongoc/src/mongoc/mongoc-gridfs.c
+ libmongoc/src/mongoc/mongoc-handshake.c
  libmongoc/src/mongoc/mongoc-host-list.c
  libmongoc/src/mongoc/mongoc-index.c libmongoc/src/mongoc/mongoc-init.c
+ libmongoc/src/mongoc/mongoc-linux-distro-scanner.c
  libmongoc/src/mongoc/mongoc-list.c libmongoc/src/mongoc/mongoc-log.c
  libmongoc/src/mongoc/mongoc-matcher-op.c libmongoc/src/mongoc/mongoc-matcher.c
  libmongoc/src/mongoc/mongoc-memcmp.c
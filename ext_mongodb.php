@@ -316,7 +316,7 @@ final class Cursor implements Traversable, Iterator {
 	* @return ReturnType -
 	*/
 	<<__Native>>
-	public function next(): mixed;
+	public function next(): void;
 
 	/**
 	* Rewind the iterator to the first element
@@ -337,6 +337,16 @@ final class Cursor implements Traversable, Iterator {
 	<<__Native>>
 	public function toArray(): array;
 
+	/**
+	* Move forward to the next element, if there is one yet. For tailable
+	* cursors, running out of documents does not end the cursor: call
+	* tryNext() again until isDead() returns true.
+	*
+	* @return bool - whether there is a new current element
+	*/
+	<<__Native>>
+	public function tryNext(): bool;
+
 	<<__Native>>
 	public function setTypeMap(array $typemap): void;
 }
@@ -402,6 +412,81 @@ final class Query {
 				Utils::mustBeArrayOrObject('sort', $options['sort']);
 				$this->query['query']['$orderby'] = (object) $options['sort'];
 			}
+
+			if (array_key_exists('exhaust', $options) && $options['exhaust']) {
+				$this->query['flags'] |= self::FLAG_EXHAUST;
+			}
+
+			/* The server streams every batch of an exhaust cursor, which it
+			 * can't do if it also has to stop at a limit */
+			if (($this->query['flags'] & self::FLAG_EXHAUST) && $this->query['limit'] != 0) {
+				throw new \MongoDB\Driver\Exception\InvalidArgumentException(
+					'Exhaust cursors can not be combined with the "limit" option'
+				);
+			}
+
+			if (array_key_exists('tailable', $options) && $options['tailable']) {
+				$this->query['flags'] |= self::FLAG_TAILABLE_CURSOR;
+			}
+
+			if (array_key_exists('awaitData', $options) && $options['awaitData']) {
+				$this->query['flags'] |= self::FLAG_AWAIT_DATA;
+			}
+
+			if (($this->query['flags'] & self::FLAG_AWAIT_DATA) && !($this->query['flags'] & self::FLAG_TAILABLE_CURSOR)) {
+				throw new \MongoDB\Driver\Exception\InvalidArgumentException(
+					'The "awaitData" option requires a tailable cursor'
+				);
+			}
+
+			/* Only the getMores of an awaitData cursor wait for new data */
+			if (array_key_exists('maxAwaitTimeMS', $options)) {
+				if (!is_int($options['maxAwaitTimeMS'])) {
+					throw new \MongoDB\Driver\Exception\InvalidArgumentException(
+						'Expected "maxAwaitTimeMS" option to be integer, ' .
+						gettype($options['maxAwaitTimeMS']) . ' given'
+					);
+				}
+				if ($options['maxAwaitTimeMS'] < 0) {
+					throw new \MongoDB\Driver\Exception\InvalidArgumentException(
+						'Expected "maxAwaitTimeMS" option to be non-negative, ' .
+						$options['maxAwaitTimeMS'] . ' given'
+					);
+				}
+				if (!($this->query['flags'] & self::FLAG_AWAIT_DATA)) {
+					throw new \MongoDB\Driver\Exception\InvalidArgumentException(
+						'The "maxAwaitTimeMS" option requires the "awaitData" option'
+					);
+				}
+				$this->query['maxAwaitTimeMS'] = $options['maxAwaitTimeMS'];
+			}
+
+			if (array_key_exists('prefetch', $options)) {
+				/* A tailable cursor running out of documents isn't the end of
+				 * it, but it is for the prefetch thread */
+				if ($options['prefetch'] && ($this->query['flags'] & self::FLAG_TAILABLE_CURSOR)) {
+					throw new \MongoDB\Driver\Exception\InvalidArgumentException(
+						'The "prefetch" option can not be used with tailable cursors'
+					);
+				}
+				$this->query['prefetch'] = (bool) $options['prefetch'];
+			}
+
+			if (array_key_exists('prefetchMaxBytes', $options)) {
+				if (!is_int($options['prefetchMaxBytes'])) {
+					throw new \MongoDB\Driver\Exception\InvalidArgumentException(
+						'Expected "prefetchMaxBytes" option to be integer, ' .
+						gettype($options['prefetchMaxBytes']) . ' given'
+					);
+				}
+				if ($options['prefetchMaxBytes'] < 1) {
+					throw new \MongoDB\Driver\Exception\InvalidArgumentException(
+						'Expected "prefetchMaxBytes" option to be positive, ' .
+						$options['prefetchMaxBytes'] . ' given'
+					);
+				}
+				$this->query['prefetchMaxBytes'] = $options['prefetchMaxBytes'];
+			}
 		}
 
 		$this->query['query']['$query'] = (object) $filter;
@@ -623,6 +708,22 @@ namespace MongoDB\BSON;
 <<__Native>>
 function fromPHP(mixed $data) : string;
 
+<<__Native>>
+function _fromPHPMany(array $documents, mixed &$offsets) : string;
+
+function fromPHPMany(mixed $documents, mixed &$offsets = NULL) : string
+{
+	if ($documents instanceof \Traversable) {
+		$documents = iterator_to_array($documents, false);
+	}
+
+	if (!is_array($documents)) {
+		throw new \MongoDB\Driver\Exception\InvalidArgumentException("Expected documents to be an array or Traversable, " . gettype($documents) . " given");
+	}
+
+	return _fromPHPMany($documents, $offsets);
+}
+
 <<__Native>>
 function fromJson(string $data) : mixed;
 
@@ -632,6 +733,19 @@ function toPHP(string $data, ?array $typemap = array()) : mixed;
 <<__Native>>
 function toJson(string $data) : mixed;
 
+<<__Native>>
+function toCanonicalExtendedJSON(string $data) : string;
+
+<<__Native>>
+function toRelaxedExtendedJSON(string $data) : string;
+
+<<__Native>>
+function readDocuments(mixed $source, ?array $typemap = array()) : DocumentReader;
+
+/* Allocations made for keys while encoding, in debug builds only */
+<<__Native>>
+function _keyAllocations() : mixed;
+
 trait DenySerialization
 {
 	public function serialize() : string
@@ -665,16 +779,22 @@ interface Persistable extends Serializable, Unserializable
 {
 }
 
+<<__NativeData("MongoDBBsonBinary")>>
 final class Binary implements Type, \Serializable
 {
 	use DenySerialization;
 
+	<<__Native>>
+	private function _init(string $data, int $type) : void;
+
 	public function __construct(private string $data, private int $type)
 	{
 		if ( $type < 0 || $type > 255 )
 		{
 			throw new \MongoDB\Driver\Exception\InvalidArgumentException( "Expected type to be an unsigned 8-bit integer, {$type} given" );
 		}
+
+		$this->_init($data, $type);
 	}
 
 	public function getType()
@@ -687,10 +807,8 @@ final class Binary implements Type, \Serializable
 		return $this->type;
 	}
 
-	public function getData() : string
-	{
-		return $this->data;
-	}
+	<<__Native>>
+	public function getData() : string;
 
 	<<__Native>>
 	function __debugInfo() : array;
@@ -711,21 +829,94 @@ final class Decimal128 implements Type, \Serializable
 	function __debugInfo() : array;
 }
 
-final class Javascript implements Type, \Serializable
+<<__NativeData("MongoDBBsonDocument")>>
+final class Document implements Type, \IteratorAggregate, \Serializable
 {
 	use DenySerialization;
 
-	public function __construct(private string $code, private ?mixed $scope = NULL)
+	private function __construct()
+	{
+	}
+
+	<<__Native>>
+	private function _init(string $bson) : void;
+
+	public static function fromBSON(string $bson) : Document
+	{
+		$document = new self();
+		$document->_init($bson);
+
+		return $document;
+	}
+
+	<<__Native>>
+	public function get(string $key) : mixed;
+
+	<<__Native>>
+	public function has(string $key) : bool;
+
+	<<__Native>>
+	private function _elements() : array;
+
+	public function getIterator() : \Iterator
 	{
+		return new \ArrayIterator($this->_elements());
 	}
 
+	<<__Native>>
+	public function toPHP(?array $typemap = NULL) : mixed;
+
+	<<__Native>>
+	public function __toString() : string;
+
 	public function __debugInfo() : array
 	{
-		return [
-			'javascript' => $this->code,
-			'scope' => (object) $this->scope
-		];
+		return $this->_elements();
+	}
+}
+
+<<__NativeData("MongoDBBsonDocumentReader")>>
+final class DocumentReader implements \Iterator
+{
+	private function __construct()
+	{
+		throw new \MongoDB\Driver\Exception\RunTimeException("Accessing private constructor");
+	}
+
+	<<__Native>>
+	public function current() : mixed;
+
+	<<__Native>>
+	public function key() : int;
+
+	<<__Native>>
+	public function next() : void;
+
+	<<__Native>>
+	public function rewind() : void;
+
+	<<__Native>>
+	public function valid() : bool;
+
+	<<__Native>>
+	public function tell() : int;
+}
+
+<<__NativeData("MongoDBBsonJavascript")>>
+final class Javascript implements Type, \Serializable
+{
+	use DenySerialization;
+
+	<<__Native>>
+	private function _init(string $code, mixed $scope) : void;
+
+	public function __construct(private string $code, private ?mixed $scope = NULL)
+	{
+		$this->_init($code, $scope);
 	}
+
+	<<__Native>>
+	public function __debugInfo() : array;
 }
 
 final class MaxKey implements Type, \Serializable
@@ -758,42 +949,86 @@ final class ObjectID implements Type, \Serializable
 	}
 }
 
-final class Regex implements Type, \Serializable
+<<__NativeData("MongoDBBsonPackedArray")>>
+final class PackedArray implements Type, \IteratorAggregate, \Serializable
 {
 	use DenySerialization;
 
-	public function __construct(private string $pattern, private string $flags)
+	private function __construct()
 	{
 	}
 
-	public function getPattern() : string
+	<<__Native>>
+	private function _init(string $bson) : void;
+
+	public static function fromBSON(string $bson) : PackedArray
 	{
-		return $this->pattern;
+		$array = new self();
+		$array->_init($bson);
+
+		return $array;
 	}
 
-	public function getFlags() : string
+	<<__Native>>
+	public function get(int $index) : mixed;
+
+	<<__Native>>
+	public function has(int $index) : bool;
+
+	<<__Native>>
+	private function _elements() : array;
+
+	public function getIterator() : \Iterator
 	{
-		return $this->flags;
+		return new \ArrayIterator($this->_elements());
 	}
 
-	public function __toString() : string
+	<<__Native>>
+	public function toPHP(?array $typemap = NULL) : mixed;
+
+	<<__Native>>
+	public function __toString() : string;
+
+	public function __debugInfo() : array
 	{
-		return "/{$this->pattern}/{$this->flags}";
+		return $this->_elements();
 	}
+}
 
-	public function __debugInfo() : array
+<<__NativeData("MongoDBBsonRegex")>>
+final class Regex implements Type, \Serializable
+{
+	use DenySerialization;
+
+	<<__Native>>
+	private function _init(string $pattern, string $flags) : void;
+
+	public function __construct(private string $pattern, private string $flags)
 	{
-		return [
-			'pattern' => $this->pattern,
-			'flags' => $this->flags
-		];
+		$this->_init($pattern, $flags);
 	}
+
+	<<__Native>>
+	public function getPattern() : string;
+
+	<<__Native>>
+	public function getFlags() : string;
+
+	<<__Native>>
+	public function __toString() : string;
+
+	<<__Native>>
+	public function __debugInfo() : array;
 }
 
+<<__NativeData("MongoDBBsonTimestamp")>>
 final class Timestamp implements Type, \Serializable
 {
 	use DenySerialization;
 
+	<<__Native>>
+	private function _init(int $increment, int $timestamp) : void;
+
 	public function __construct(private int $increment, private int $timestamp)
 	{
 		if ( $increment < 0 || $increment > 4294967295 )
@@ -804,51 +1039,48 @@ final class Timestamp implements Type, \Serializable
 		{
 			throw new \MongoDB\Driver\Exception\InvalidArgumentException( "Expected timestamp to be an unsigned 32-bit integer, {$timestamp} given" );
 		}
-	}
 
-	public function __toString() : string
-	{
-		return sprintf( "[%d:%d]", $this->increment, $this->timestamp );
+		$this->_init($increment, $timestamp);
 	}
 
-	public function __debugInfo() : array
-	{
-		return [
-			'increment' => $this->increment,
-			'timestamp' => $this->timestamp
-		];
-	}
+	<<__Native>>
+	public function __toString() : string;
+
+	<<__Native>>
+	public function __debugInfo() : array;
 }
 
+<<__NativeData("MongoDBBsonUTCDateTime")>>
 final class UTCDateTime implements Type, \Serializable
 {
 	use DenySerialization;
 
 	private int $milliseconds;
 
+	<<__Native>>
+	private function _init(int $milliseconds) : void;
+
 	public function __construct(mixed $milliseconds = NULL)
 	{
 		if ($milliseconds === NULL) {
-			$this->milliseconds = floor( microtime( true ) * 1000 );
+			$this->milliseconds = (int) floor( microtime( true ) * 1000 );
 		} elseif (is_object($milliseconds) && get_class($milliseconds) == 'DateTime') {
-			$this->milliseconds = floor( (string) $milliseconds->format('U.u') * 1000 );
+			$this->milliseconds = (int) floor( (string) $milliseconds->format('U.u') * 1000 );
 		} else {
 			$this->milliseconds = (int) $milliseconds;
 		}
-	}
 
-	public function __toString() : string
-	{
-		return (string) $this->milliseconds;
+		$this->_init($this->milliseconds);
 	}
 
+	<<__Native>>
+	public function __toString() : string;
+
 	<<__Native>>
 	public function toDateTime() : \DateTime;
 
-	public function __debugInfo() : array
-	{
-		return [ 'milliseconds' => $this->milliseconds ];
-	}
+	<<__Native>>
+	public function __debugInfo() : array;
 }
 
 /* }}} */
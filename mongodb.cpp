@@ -32,8 +32,13 @@
 #include "src/MongoDB/BSON/functions.h"
 #include "src/MongoDB/BSON/Binary.h"
 #include "src/MongoDB/BSON/Decimal128.h"
+#include "src/MongoDB/BSON/Document.h"
+#include "src/MongoDB/BSON/DocumentReader.h"
 #include "src/MongoDB/BSON/Javascript.h"
 #include "src/MongoDB/BSON/ObjectID.h"
+#include "src/MongoDB/BSON/PackedArray.h"
+#include "src/MongoDB/BSON/Regex.h"
+#include "src/MongoDB/BSON/Timestamp.h"
 #include "src/MongoDB/BSON/UTCDateTime.h"
 
 #include "mongodb.h"
@@ -89,9 +94,14 @@ static class MongoDBExtension : public Extension {
 		virtual void moduleInit() {
 			/* MongoDB\BSON functions */
 			HHVM_FALIAS(MongoDB\\BSON\\fromPHP, MongoDBBsonFromPHP);
+			HHVM_FALIAS(MongoDB\\BSON\\_fromPHPMany, MongoDBBsonFromPHPMany);
 			HHVM_FALIAS(MongoDB\\BSON\\fromJson, MongoDBBsonFromJson);
 			HHVM_FALIAS(MongoDB\\BSON\\toPHP, MongoDBBsonToPHP);
 			HHVM_FALIAS(MongoDB\\BSON\\toJson, MongoDBBsonToJson);
+			HHVM_FALIAS(MongoDB\\BSON\\toCanonicalExtendedJSON, MongoDBBsonToCanonicalExtendedJson);
+			HHVM_FALIAS(MongoDB\\BSON\\toRelaxedExtendedJSON, MongoDBBsonToRelaxedExtendedJson);
+			HHVM_FALIAS(MongoDB\\BSON\\readDocuments, MongoDBBsonReadDocuments);
+			HHVM_FALIAS(MongoDB\\BSON\\_keyAllocations, MongoDBBsonKeyAllocations);
 
 			/* MongoDB\BSON\Binary */
 			Native::registerClassConstant<KindOfInt64>(s_MongoBsonBinary_className.get(), makeStaticString("TYPE_GENERIC"), (int64_t) BSON_SUBTYPE_BINARY);
@@ -102,7 +112,11 @@ static class MongoDBExtension : public Extension {
 			Native::registerClassConstant<KindOfInt64>(s_MongoBsonBinary_className.get(), makeStaticString("TYPE_MD5"), (int64_t) BSON_SUBTYPE_MD5);
 			Native::registerClassConstant<KindOfInt64>(s_MongoBsonBinary_className.get(), makeStaticString("TYPE_USER_DEFINED"), (int64_t) BSON_SUBTYPE_USER);
 
+			HHVM_MALIAS(MongoDB\\BSON\\Binary, _init, MongoDBBsonBinary, _init);
 			HHVM_MALIAS(MongoDB\\BSON\\Binary, __debugInfo, MongoDBBsonBinary, __debugInfo);
+			HHVM_MALIAS(MongoDB\\BSON\\Binary, getData, MongoDBBsonBinary, getData);
+
+			Native::registerNativeDataInfo<MongoDBBsonBinaryData>(MongoDBBsonBinaryData::s_className.get());
 
 			/* MongoDB\BSON\Decimal128 */
 			HHVM_MALIAS(MongoDB\\BSON\\Decimal128, __construct, MongoDBBsonDecimal128, __construct);
@@ -111,6 +125,32 @@ static class MongoDBExtension : public Extension {
 
 			Native::registerNativeDataInfo<MongoDBBsonDecimal128Data>(MongoDBBsonDecimal128Data::s_className.get());
 
+			/* MongoDB\BSON\Document */
+			HHVM_MALIAS(MongoDB\\BSON\\Document, _elements, MongoDBBsonDocument, _elements);
+			HHVM_MALIAS(MongoDB\\BSON\\Document, _init, MongoDBBsonDocument, _init);
+			HHVM_MALIAS(MongoDB\\BSON\\Document, __toString, MongoDBBsonDocument, __toString);
+			HHVM_MALIAS(MongoDB\\BSON\\Document, get, MongoDBBsonDocument, get);
+			HHVM_MALIAS(MongoDB\\BSON\\Document, has, MongoDBBsonDocument, has);
+			HHVM_MALIAS(MongoDB\\BSON\\Document, toPHP, MongoDBBsonDocument, toPHP);
+
+			Native::registerNativeDataInfo<MongoDBBsonDocumentData>(MongoDBBsonDocumentData::s_className.get());
+
+			/* MongoDB\BSON\DocumentReader */
+			HHVM_MALIAS(MongoDB\\BSON\\DocumentReader, current, MongoDBBsonDocumentReader, current);
+			HHVM_MALIAS(MongoDB\\BSON\\DocumentReader, key, MongoDBBsonDocumentReader, key);
+			HHVM_MALIAS(MongoDB\\BSON\\DocumentReader, next, MongoDBBsonDocumentReader, next);
+			HHVM_MALIAS(MongoDB\\BSON\\DocumentReader, rewind, MongoDBBsonDocumentReader, rewind);
+			HHVM_MALIAS(MongoDB\\BSON\\DocumentReader, tell, MongoDBBsonDocumentReader, tell);
+			HHVM_MALIAS(MongoDB\\BSON\\DocumentReader, valid, MongoDBBsonDocumentReader, valid);
+
+			Native::registerNativeDataInfo<MongoDBBsonDocumentReaderData>(MongoDBBsonDocumentReaderData::s_className.get());
+
+			/* MongoDB\BSON\Javascript */
+			HHVM_MALIAS(MongoDB\\BSON\\Javascript, _init, MongoDBBsonJavascript, _init);
+			HHVM_MALIAS(MongoDB\\BSON\\Javascript, __debugInfo, MongoDBBsonJavascript, __debugInfo);
+
+			Native::registerNativeDataInfo<MongoDBBsonJavascriptData>(MongoDBBsonJavascriptData::s_className.get());
+
 			/* MongoDB\BSON\ObjectID */
 			HHVM_MALIAS(MongoDB\\BSON\\ObjectID, __construct, MongoDBBsonObjectID, __construct);
 			HHVM_MALIAS(MongoDB\\BSON\\ObjectID, __debugInfo, MongoDBBsonObjectID, __debugInfo);
@@ -118,9 +158,40 @@ static class MongoDBExtension : public Extension {
 
 			Native::registerNativeDataInfo<MongoDBBsonObjectIDData>(MongoDBBsonObjectIDData::s_className.get());
 
+			/* MongoDB\BSON\PackedArray */
+			HHVM_MALIAS(MongoDB\\BSON\\PackedArray, _elements, MongoDBBsonPackedArray, _elements);
+			HHVM_MALIAS(MongoDB\\BSON\\PackedArray, _init, MongoDBBsonPackedArray, _init);
+			HHVM_MALIAS(MongoDB\\BSON\\PackedArray, __toString, MongoDBBsonPackedArray, __toString);
+			HHVM_MALIAS(MongoDB\\BSON\\PackedArray, get, MongoDBBsonPackedArray, get);
+			HHVM_MALIAS(MongoDB\\BSON\\PackedArray, has, MongoDBBsonPackedArray, has);
+			HHVM_MALIAS(MongoDB\\BSON\\PackedArray, toPHP, MongoDBBsonPackedArray, toPHP);
+
+			Native::registerNativeDataInfo<MongoDBBsonPackedArrayData>(MongoDBBsonPackedArrayData::s_className.get());
+
+			/* MongoDB\BSON\Regex */
+			HHVM_MALIAS(MongoDB\\BSON\\Regex, _init, MongoDBBsonRegex, _init);
+			HHVM_MALIAS(MongoDB\\BSON\\Regex, __debugInfo, MongoDBBsonRegex, __debugInfo);
+			HHVM_MALIAS(MongoDB\\BSON\\Regex, __toString, MongoDBBsonRegex, __toString);
+			HHVM_MALIAS(MongoDB\\BSON\\Regex, getFlags, MongoDBBsonRegex, getFlags);
+			HHVM_MALIAS(MongoDB\\BSON\\Regex, getPattern, MongoDBBsonRegex, getPattern);
+
+			Native::registerNativeDataInfo<MongoDBBsonRegexData>(MongoDBBsonRegexData::s_className.get());
+
+			/* MongoDB\BSON\Timestamp */
+			HHVM_MALIAS(MongoDB\\BSON\\Timestamp, _init, MongoDBBsonTimestamp, _init);
+			HHVM_MALIAS(MongoDB\\BSON\\Timestamp, __debugInfo, MongoDBBsonTimestamp, __debugInfo);
+			HHVM_MALIAS(MongoDB\\BSON\\Timestamp, __toString, MongoDBBsonTimestamp, __toString);
+
+			Native::registerNativeDataInfo<MongoDBBsonTimestampData>(MongoDBBsonTimestampData::s_className.get());
+
 			/* MongoDB\BSON\UTCDateTime */
+			HHVM_MALIAS(MongoDB\\BSON\\UTCDateTime, _init, MongoDBBsonUTCDateTime, _init);
+			HHVM_MALIAS(MongoDB\\BSON\\UTCDateTime, __debugInfo, MongoDBBsonUTCDateTime, __debugInfo);
+			HHVM_MALIAS(MongoDB\\BSON\\UTCDateTime, __toString, MongoDBBsonUTCDateTime, __toString);
 			HHVM_MALIAS(MongoDB\\BSON\\UTCDateTime, toDateTime, MongoDBBsonUTCDateTime, toDateTime);
 
+			Native::registerNativeDataInfo<MongoDBBsonUTCDateTimeData>(MongoDBBsonUTCDateTimeData::s_className.get());
+
 			/* MongoDB\Driver\Manager */
 			HHVM_MALIAS(MongoDB\\Driver\\Manager, __construct, MongoDBDriverManager, __construct);
 			HHVM_MALIAS(MongoDB\\Driver\\Manager, __debugInfo, MongoDBDriverManager, __debugInfo);
@@ -164,6 +235,7 @@ static class MongoDBExtension : public Extension {
 			HHVM_MALIAS(MongoDB\\Driver\\Cursor, valid, MongoDBDriverCursor, valid);
 			HHVM_MALIAS(MongoDB\\Driver\\Cursor, isDead, MongoDBDriverCursor, isDead);
 			HHVM_MALIAS(MongoDB\\Driver\\Cursor, toArray, MongoDBDriverCursor, toArray);
+			HHVM_MALIAS(MongoDB\\Driver\\Cursor, tryNext, MongoDBDriverCursor, tryNext);
 
 			Native::registerNativeDataInfo<MongoDBDriverCursorData>(MongoDBDriverCursorData::s_className.get());
 
@@ -254,6 +326,10 @@ static class MongoDBExtension : public Extension {
 			mongoc_log_trace_enable();
 		}
 
+		void requestShutdown() override {
+			hippo_bson_cache_reset();
+		}
+
 		void threadInit() override {
 			IniSetting::Bind(
 				this, IniSetting::PHP_INI_SYSTEM,
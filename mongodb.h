@@ -24,4 +24,27 @@
 		return s_class; \
 	}
 
+/* Classes declared in ext_mongodb.php come from the systemlib, which makes
+ * them persistent: a Class* that has been looked up once stays valid for the
+ * lifetime of the process. */
+#define HIPPO_LOOKUP_SYSTEMLIB_CLASS(var, name) \
+	do { \
+		if (var == nullptr) { \
+			var = HPHP::Unit::lookupClass((name).get()); \
+			assert(var); \
+		} \
+	} while (0)
+
+/* == compares objects by their declared properties, and does not see native
+ * data. The BSON value classes therefore also keep their state in private
+ * properties, which the create*Object() functions set through their slots.
+ * Like the classes themselves, those slots never change once looked up. */
+#define HIPPO_LOOKUP_SYSTEMLIB_PROP_SLOT(var, cls, name) \
+	do { \
+		if (var == HPHP::kInvalidSlot) { \
+			var = (cls)->lookupDeclProp((name).get()); \
+			assert(var != HPHP::kInvalidSlot); \
+		} \
+	} while (0)
+
 #define HIPPO_HHVM_VERSION (HHVM_VERSION_MAJOR * 10000 + HHVM_VERSION_MINOR * 100 + HHVM_VERSION_PATCH)
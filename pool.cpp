@@ -29,6 +29,7 @@ extern "C" {
 
 namespace {
 	thread_local std::unordered_map<std::string, std::shared_ptr<HPHP::Pool>> s_connections;
+	thread_local std::unordered_map<mongoc_client_t*, std::shared_ptr<std::mutex>> s_client_locks;
 }
 
 namespace HPHP {
@@ -115,4 +116,26 @@ void Pool::ReturnClient(const std::string hash, mongoc_client_t *client)
 	}
 }
 
+std::shared_ptr<std::mutex> Pool::ShareClient(mongoc_client_t *client)
+{
+	auto &lock = s_client_locks[client];
+
+	if (!lock) {
+		lock = std::make_shared<std::mutex>();
+	}
+
+	return lock;
+}
+
+std::unique_lock<std::mutex> Pool::LockClient(mongoc_client_t *client)
+{
+	auto lock = s_client_locks.find(client);
+
+	if (lock == s_client_locks.end()) {
+		return std::unique_lock<std::mutex>();
+	}
+
+	return std::unique_lock<std::mutex>(*lock->second);
+}
+
 }
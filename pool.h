@@ -16,6 +16,9 @@
 #ifndef __MONGODB_DRIVER_POOL_H__
 #define __MONGODB_DRIVER_POOL_H__
 
+#include <memory>
+#include <mutex>
+
 extern "C" {
 #include "../../../libmongoc/src/mongoc/mongoc.h"
 }
@@ -36,6 +39,13 @@ class Pool
 
 		static mongoc_client_t *GetClient(std::string hash, mongoc_uri_t *uri);
 		static void ReturnClient(const std::string hash, mongoc_client_t *client);
+
+		/* Clients are not thread safe. Once a cursor hands its client to a
+		 * prefetch thread, everything else using that client has to hold
+		 * its lock. LockClient() returns an unlocked guard for clients that
+		 * have never been shared. */
+		static std::shared_ptr<std::mutex> ShareClient(mongoc_client_t *client);
+		static std::unique_lock<std::mutex> LockClient(mongoc_client_t *client);
 };
 
 }
@@ -17,6 +17,8 @@
 #include "hphp/runtime/ext/extension.h"
 #include "hphp/runtime/vm/native-data.h"
 
+#include "../../../mongodb.h"
+
 #include "Binary.h"
 
 namespace HPHP {
@@ -24,34 +26,53 @@ namespace HPHP {
 const StaticString s_MongoBsonBinary_className("MongoDB\\BSON\\Binary");
 const StaticString s_MongoBsonBinary_data("data");
 const StaticString s_MongoBsonBinary_type("type");
+Class* MongoDBBsonBinaryData::s_class = nullptr;
+const StaticString MongoDBBsonBinaryData::s_className("MongoDBBsonBinary");
+IMPLEMENT_GET_CLASS(MongoDBBsonBinaryData);
 
 Object createMongoBsonBinaryObject(const uint8_t *v_binary, size_t v_binary_len, bson_subtype_t v_subtype)
 {
 	static Class* c_binary;
-	String s;
-	unsigned char *data_s;
-
-	s = String(v_binary_len, ReserveString);
-	data_s = (unsigned char*) s.bufferSlice().data();
-	memcpy(data_s, v_binary, v_binary_len);
-	s.setSize(v_binary_len);
+	static Slot s_data_slot = kInvalidSlot, s_type_slot = kInvalidSlot;
+	MongoDBBsonBinaryData* data;
 
-	c_binary = Unit::lookupClass(s_MongoBsonBinary_className.get());
-	assert(c_binary);
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_binary, s_MongoBsonBinary_className);
+	HIPPO_LOOKUP_SYSTEMLIB_PROP_SLOT(s_data_slot, c_binary, s_MongoBsonBinary_data);
+	HIPPO_LOOKUP_SYSTEMLIB_PROP_SLOT(s_type_slot, c_binary, s_MongoBsonBinary_type);
 	Object obj = Object{c_binary};
 
-	obj->o_set(s_MongoBsonBinary_data, s, s_MongoBsonBinary_className);
-	obj->o_set(s_MongoBsonBinary_type, Variant(v_subtype), s_MongoBsonBinary_className);
+	data = Native::data<MongoDBBsonBinaryData>(obj.get());
+	data->m_data = String((const char*) v_binary, v_binary_len, CopyString);
+	data->m_type = v_subtype;
+
+	tvAsVariant(&obj->propVec()[s_data_slot]) = data->m_data;
+	tvAsVariant(&obj->propVec()[s_type_slot]) = (int64_t) v_subtype;
 
 	return obj;
 }
 
+void HHVM_METHOD(MongoDBBsonBinary, _init, const String &data, int64_t type)
+{
+	MongoDBBsonBinaryData* obj_data = Native::data<MongoDBBsonBinaryData>(this_);
+
+	obj_data->m_data = data;
+	obj_data->m_type = (bson_subtype_t) type;
+}
+
+String HHVM_METHOD(MongoDBBsonBinary, getData)
+{
+	MongoDBBsonBinaryData* data = Native::data<MongoDBBsonBinaryData>(this_);
+
+	return data->m_data;
+}
+
 Array HHVM_METHOD(MongoDBBsonBinary, __debugInfo)
 {
+	MongoDBBsonBinaryData* data = Native::data<MongoDBBsonBinaryData>(this_);
 	Array retval = Array::Create();
 
-	retval.set(s_MongoBsonBinary_data, this_->o_get(s_MongoBsonBinary_data, false, s_MongoBsonBinary_className));
-	retval.set(s_MongoBsonBinary_type, this_->o_get(s_MongoBsonBinary_type, false, s_MongoBsonBinary_className));
+	retval.set(s_MongoBsonBinary_data, data->m_data);
+	retval.set(s_MongoBsonBinary_type, (int64_t) data->m_type);
 
 	return retval;
 }
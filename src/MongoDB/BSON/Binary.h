@@ -26,9 +26,29 @@ extern const StaticString s_MongoBsonBinary_className;
 extern const StaticString s_MongoBsonBinary_data;
 extern const StaticString s_MongoBsonBinary_type;
 
+class MongoDBBsonBinaryData
+{
+	public:
+		static Class* s_class;
+		static const StaticString s_className;
+
+		static Class* getClass();
+
+		String m_data;
+		bson_subtype_t m_type;
+
+		void sweep() {
+		}
+
+		~MongoDBBsonBinaryData() {
+			sweep();
+		};
+};
+
 Object createMongoBsonBinaryObject(const uint8_t *v_binary, size_t v_binary_len, bson_subtype_t v_subtype);
 
+void HHVM_METHOD(MongoDBBsonBinary, _init, const String &data, int64_t type);
+String HHVM_METHOD(MongoDBBsonBinary, getData);
 Array HHVM_METHOD(MongoDBBsonBinary, __debugInfo);
 }
 #endif
-
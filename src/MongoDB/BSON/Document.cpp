@@ -0,0 +1,263 @@
+/**
+ *  Copyright 2014-2015 MongoDB, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "hphp/runtime/ext/extension.h"
+#include "hphp/runtime/vm/native-data.h"
+
+#include "../../../bson.h"
+#include "../../../mongodb.h"
+#include "../../../utils.h"
+
+#include "Document.h"
+#include "PackedArray.h"
+
+namespace HPHP {
+
+const StaticString s_MongoBsonDocument_className("MongoDB\\BSON\\Document");
+Class* MongoDBBsonDocumentData::s_class = nullptr;
+const StaticString MongoDBBsonDocumentData::s_className("MongoDBBsonDocument");
+IMPLEMENT_GET_CLASS(MongoDBBsonDocumentData);
+
+Object createMongoBsonDocumentObject(const String &data, uint32_t offset, uint32_t length)
+{
+	static Class* c_document;
+	MongoDBBsonDocumentData* obj_data;
+
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_document, s_MongoBsonDocument_className);
+	Object obj = Object{c_document};
+
+	obj_data = Native::data<MongoDBBsonDocumentData>(obj.get());
+	obj_data->m_data = data;
+	obj_data->m_offset = offset;
+	obj_data->m_length = length;
+	obj_data->m_cache = Array::Create();
+
+	return obj;
+}
+
+/* {{{ Helpers shared with MongoDB\BSON\PackedArray */
+bool hippo_bson_view_init(bson_t *b, const String &data, uint32_t offset, uint32_t length)
+{
+	if ((size_t) offset + length > (size_t) data.size()) {
+		return false;
+	}
+
+	return bson_init_static(b, (const uint8_t*) data.data() + offset, length);
+}
+
+/* Embedded documents and arrays become views on the same buffer; everything
+ * else is decoded with the regular visitors and the default type map */
+Variant hippo_bson_view_element(const String &data, const bson_iter_t *iter)
+{
+	const uint8_t *child = NULL;
+	uint32_t child_len = 0;
+	hippo_bson_state state;
+	hippo_bson_conversion_options_t options = HIPPO_TYPEMAP_INITIALIZER;
+
+	switch (bson_iter_type(iter)) {
+		case BSON_TYPE_DOCUMENT:
+			bson_iter_document(iter, &child_len, &child);
+			break;
+
+		case BSON_TYPE_ARRAY:
+			bson_iter_array(iter, &child_len, &child);
+			break;
+
+		default:
+			state.zchild = Array::Create();
+			state.options = options;
+			state.options.current_compound_type = HIPPO_BSONTYPE_ARRAY;
+
+			if (hippo_bson_visit_one(iter, &state)) {
+				throw MongoDriver::Utils::throwUnexpectedValueException("Detected corrupt BSON data");
+			}
+
+			return state.zchild.size() ? state.zchild[0] : Variant();
+	}
+
+	if (!child) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Detected corrupt BSON data");
+	}
+
+	if (bson_iter_type(iter) == BSON_TYPE_ARRAY) {
+		return Variant(createMongoBsonPackedArrayObject(data, child - (const uint8_t*) data.data(), child_len));
+	}
+
+	return Variant(createMongoBsonDocumentObject(data, child - (const uint8_t*) data.data(), child_len));
+}
+
+/* Decodes every element of the view, reusing (and filling in) the cache that
+ * get() uses, so that neither iterating again nor the get() calls that follow
+ * have to decode anything a second time. Keys that get() can't look up as
+ * they are, such as ones containing a ".", are left out of the cache. */
+Array hippo_bson_view_elements(const String &data, uint32_t offset, uint32_t length, bool is_array, Array &cache)
+{
+	bson_t b;
+	bson_iter_t iter;
+	Array retval = Array::Create();
+
+	if (!hippo_bson_view_init(&b, data, offset, length) || !bson_iter_init(&iter, &b)) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Detected corrupt BSON data");
+	}
+
+	while (bson_iter_next(&iter)) {
+		const char *key = bson_iter_key(&iter);
+		Variant cache_key;
+		Variant v;
+
+		if (is_array) {
+			char *end;
+			int64_t index = strtoll(key, &end, 10);
+
+			if (*key && !*end) {
+				cache_key = index;
+			}
+		} else if (!strchr(key, '.')) {
+			cache_key = String(key, CopyString);
+		}
+
+		if (!cache_key.isNull() && cache.exists(cache_key)) {
+			v = cache[cache_key];
+		} else {
+			v = hippo_bson_view_element(data, &iter);
+
+			if (!cache_key.isNull()) {
+				cache.set(cache_key, v);
+			}
+		}
+
+		if (is_array) {
+			retval.append(v);
+		} else {
+			retval.set(String(key, CopyString), v);
+		}
+	}
+
+	if (iter.err_off) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Detected corrupt BSON data");
+	}
+
+	return retval;
+}
+
+Variant hippo_bson_view_to_php(const String &data, uint32_t offset, uint32_t length, int compound_type, const Variant &typemap)
+{
+	Variant v;
+	hippo_bson_conversion_options_t options = HIPPO_TYPEMAP_INITIALIZER;
+
+	if (typemap.isArray()) {
+		parseTypeMap(&options, typemap.toArray());
+	}
+	options.current_compound_type = compound_type;
+
+	BsonToVariantConverter convertor((const unsigned char*) data.data() + offset, length, options);
+	convertor.convert(&v);
+
+	return v;
+}
+/* }}} */
+
+void HHVM_METHOD(MongoDBBsonDocument, _init, const String &bson)
+{
+	MongoDBBsonDocumentData* data = Native::data<MongoDBBsonDocumentData>(this_);
+	bson_t b;
+	size_t err_offset;
+
+	if (!hippo_bson_view_init(&b, bson, 0, bson.size()) || !bson_validate(&b, BSON_VALIDATE_NONE, &err_offset)) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Could not read document from BSON reader");
+	}
+
+	data->m_data = bson;
+	data->m_offset = 0;
+	data->m_length = bson.size();
+	data->m_cache = Array::Create();
+}
+
+Variant HHVM_METHOD(MongoDBBsonDocument, get, const String &key)
+{
+	MongoDBBsonDocumentData* data = Native::data<MongoDBBsonDocumentData>(this_);
+	bson_t b;
+	bson_iter_t iter;
+	bson_iter_t target;
+	Variant v;
+
+	if (data->m_cache.exists(key)) {
+		return data->m_cache[key];
+	}
+
+	if (!hippo_bson_view_init(&b, data->m_data, data->m_offset, data->m_length) || !bson_iter_init(&iter, &b)) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Detected corrupt BSON data");
+	}
+
+	/* Dotted keys descend into embedded documents and arrays */
+	if (!bson_iter_find_descendant(&iter, key.c_str(), &target)) {
+		return Variant();
+	}
+
+	v = hippo_bson_view_element(data->m_data, &target);
+	data->m_cache.set(key, v);
+
+	return v;
+}
+
+bool HHVM_METHOD(MongoDBBsonDocument, has, const String &key)
+{
+	MongoDBBsonDocumentData* data = Native::data<MongoDBBsonDocumentData>(this_);
+	bson_t b;
+	bson_iter_t iter;
+	bson_iter_t target;
+
+	if (data->m_cache.exists(key)) {
+		return true;
+	}
+
+	if (!hippo_bson_view_init(&b, data->m_data, data->m_offset, data->m_length) || !bson_iter_init(&iter, &b)) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Detected corrupt BSON data");
+	}
+
+	return bson_iter_find_descendant(&iter, key.c_str(), &target);
+}
+
+Array HHVM_METHOD(MongoDBBsonDocument, _elements)
+{
+	MongoDBBsonDocumentData* data = Native::data<MongoDBBsonDocumentData>(this_);
+
+	if (data->m_elements.isNull()) {
+		data->m_elements = hippo_bson_view_elements(data->m_data, data->m_offset, data->m_length, false, data->m_cache);
+	}
+
+	return data->m_elements.toArray();
+}
+
+Variant HHVM_METHOD(MongoDBBsonDocument, toPHP, const Variant &typemap)
+{
+	MongoDBBsonDocumentData* data = Native::data<MongoDBBsonDocumentData>(this_);
+
+	return hippo_bson_view_to_php(data->m_data, data->m_offset, data->m_length, HIPPO_BSONTYPE_ROOT, typemap);
+}
+
+String HHVM_METHOD(MongoDBBsonDocument, __toString)
+{
+	MongoDBBsonDocumentData* data = Native::data<MongoDBBsonDocumentData>(this_);
+
+	if (data->m_offset == 0 && data->m_length == (uint32_t) data->m_data.size()) {
+		return data->m_data;
+	}
+
+	return String(data->m_data.data() + data->m_offset, data->m_length, CopyString);
+}
+
+}
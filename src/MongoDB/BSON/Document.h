@@ -0,0 +1,69 @@
+/**
+ *  Copyright 2014-2015 MongoDB, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+#ifndef __MONGODB_BSON_DOCUMENT_H__
+#define __MONGODB_BSON_DOCUMENT_H__
+
+extern "C" {
+#include "../../../libbson/src/bson/bson.h"
+}
+
+namespace HPHP {
+
+extern const StaticString s_MongoBsonDocument_className;
+
+/* A Document is a read-only view on (part of) a BSON buffer. Embedded
+ * documents and arrays are handed out as views on the same String, so
+ * nothing gets copied or decoded until a value is actually asked for. */
+class MongoDBBsonDocumentData
+{
+	public:
+		static Class* s_class;
+		static const StaticString s_className;
+
+		static Class* getClass();
+
+		String m_data;
+		uint32_t m_offset;
+		uint32_t m_length;
+		Array m_cache;
+		Variant m_elements; /* all elements, once they have been iterated over */
+
+		void sweep() {
+		}
+
+		~MongoDBBsonDocumentData() {
+			sweep();
+		};
+};
+
+Object createMongoBsonDocumentObject(const String &data, uint32_t offset, uint32_t length);
+
+/* {{{ Helpers shared with MongoDB\BSON\PackedArray */
+bool hippo_bson_view_init(bson_t *b, const String &data, uint32_t offset, uint32_t length);
+Variant hippo_bson_view_element(const String &data, const bson_iter_t *iter);
+Array hippo_bson_view_elements(const String &data, uint32_t offset, uint32_t length, bool is_array, Array &cache);
+Variant hippo_bson_view_to_php(const String &data, uint32_t offset, uint32_t length, int compound_type, const Variant &typemap);
+/* }}} */
+
+void HHVM_METHOD(MongoDBBsonDocument, _init, const String &bson);
+Variant HHVM_METHOD(MongoDBBsonDocument, get, const String &key);
+bool HHVM_METHOD(MongoDBBsonDocument, has, const String &key);
+Array HHVM_METHOD(MongoDBBsonDocument, _elements);
+Variant HHVM_METHOD(MongoDBBsonDocument, toPHP, const Variant &typemap);
+String HHVM_METHOD(MongoDBBsonDocument, __toString);
+
+}
+#endif
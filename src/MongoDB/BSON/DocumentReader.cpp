@@ -0,0 +1,184 @@
+/**
+ *  Copyright 2014-2015 MongoDB, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "hphp/runtime/ext/extension.h"
+#include "hphp/runtime/base/file.h"
+#include "hphp/runtime/vm/native-data.h"
+
+#include "../../../bson.h"
+#include "../../../mongodb.h"
+#include "../../../utils.h"
+
+#include "DocumentReader.h"
+
+namespace HPHP {
+
+const StaticString s_MongoBsonDocumentReader_className("MongoDB\\BSON\\DocumentReader");
+Class* MongoDBBsonDocumentReaderData::s_class = nullptr;
+const StaticString MongoDBBsonDocumentReaderData::s_className("MongoDBBsonDocumentReader");
+IMPLEMENT_GET_CLASS(MongoDBBsonDocumentReaderData);
+
+/* Read callback for bson_reader_new_from_handle(). File::read() is used
+ * rather than readImpl(), so that data already buffered by an earlier
+ * fread() on the same stream is not lost. Returning 0 signals EOF. */
+static ssize_t hippo_bson_reader_read(void *handle, void *buf, size_t count)
+{
+	File *file = (File*) handle;
+	size_t total = 0;
+
+	while (total < count) {
+		String chunk = file->read(count - total);
+
+		if (chunk.empty()) {
+			break;
+		}
+
+		memcpy((char*) buf + total, chunk.data(), chunk.size());
+		total += chunk.size();
+	}
+
+	return total;
+}
+
+Object createMongoBsonDocumentReaderObject(const Variant &source, const hippo_bson_conversion_options_t &options)
+{
+	static Class* c_reader;
+	MongoDBBsonDocumentReaderData* data;
+
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_reader, s_MongoBsonDocumentReader_className);
+	Object obj = Object{c_reader};
+
+	data = Native::data<MongoDBBsonDocumentReaderData>(obj.get());
+	data->m_options = options;
+
+	if (source.isString()) {
+		data->m_data = source.toString();
+		data->m_reader = bson_reader_new_from_data((const uint8_t*) data->m_data.data(), data->m_data.size());
+	} else if (source.isResource()) {
+		data->m_stream = source.toResource();
+		data->m_file = dyn_cast_or_null<File>(data->m_stream);
+
+		if (!data->m_file || data->m_file->isClosed()) {
+			throw MongoDriver::Utils::throwInvalidArgumentException("Expected source to be an open stream");
+		}
+
+		/* Offsets are reported relative to the start of the stream, so that
+		 * they can be passed to fseek() to resume reading later on */
+		data->m_base_offset = data->m_file->tell();
+		data->m_reader = bson_reader_new_from_handle(data->m_file, hippo_bson_reader_read, NULL);
+	} else {
+		throw MongoDriver::Utils::throwInvalidArgumentException("Expected source to be a string or a stream");
+	}
+
+	return obj;
+}
+
+static void hippo_bson_reader_advance(MongoDBBsonDocumentReaderData *data)
+{
+	const bson_t *b;
+	bool eof = false;
+	off_t offset;
+
+	data->m_current = Variant();
+	data->m_valid = false;
+	data->m_position++;
+
+	offset = bson_reader_tell(data->m_reader);
+	b = bson_reader_read(data->m_reader, &eof);
+
+	if (!b) {
+		if (!eof) {
+			throw MongoDriver::Utils::throwUnexpectedValueException("Could not read document from BSON reader at offset " + String((int64_t) (data->m_base_offset + offset)));
+		}
+		return;
+	}
+
+	data->m_offset = data->m_base_offset + offset;
+
+	BsonToVariantConverter convertor(bson_get_data(b), b->len, data->m_options);
+	convertor.convert(&data->m_current);
+	data->m_valid = true;
+}
+
+/* Reading starts lazily, so that creating a reader never touches the
+ * stream, and so that an exception for the first document is thrown from
+ * the iteration itself */
+static void hippo_bson_reader_start(MongoDBBsonDocumentReaderData *data)
+{
+	if (data->m_position == -1) {
+		hippo_bson_reader_advance(data);
+	}
+}
+
+Variant HHVM_METHOD(MongoDBBsonDocumentReader, current)
+{
+	MongoDBBsonDocumentReaderData* data = Native::data<MongoDBBsonDocumentReaderData>(this_);
+
+	hippo_bson_reader_start(data);
+
+	return data->m_current;
+}
+
+/* The key is the byte offset at which the current document starts */
+int64_t HHVM_METHOD(MongoDBBsonDocumentReader, key)
+{
+	MongoDBBsonDocumentReaderData* data = Native::data<MongoDBBsonDocumentReaderData>(this_);
+
+	hippo_bson_reader_start(data);
+
+	return data->m_offset;
+}
+
+void HHVM_METHOD(MongoDBBsonDocumentReader, next)
+{
+	MongoDBBsonDocumentReaderData* data = Native::data<MongoDBBsonDocumentReaderData>(this_);
+
+	hippo_bson_reader_start(data);
+	hippo_bson_reader_advance(data);
+}
+
+void HHVM_METHOD(MongoDBBsonDocumentReader, rewind)
+{
+	MongoDBBsonDocumentReaderData* data = Native::data<MongoDBBsonDocumentReaderData>(this_);
+
+	if (data->m_position > 0) {
+		throw MongoDriver::Utils::throwLogicException("Document readers cannot rewind after starting iteration");
+	}
+
+	hippo_bson_reader_start(data);
+}
+
+bool HHVM_METHOD(MongoDBBsonDocumentReader, valid)
+{
+	MongoDBBsonDocumentReaderData* data = Native::data<MongoDBBsonDocumentReaderData>(this_);
+
+	hippo_bson_reader_start(data);
+
+	return data->m_valid;
+}
+
+/* The offset just past the current document, which is where reading should
+ * resume from after it has been processed */
+int64_t HHVM_METHOD(MongoDBBsonDocumentReader, tell)
+{
+	MongoDBBsonDocumentReaderData* data = Native::data<MongoDBBsonDocumentReaderData>(this_);
+
+	hippo_bson_reader_start(data);
+
+	return data->m_base_offset + bson_reader_tell(data->m_reader);
+}
+
+}
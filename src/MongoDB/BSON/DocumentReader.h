@@ -0,0 +1,80 @@
+/**
+ *  Copyright 2014-2015 MongoDB, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+#ifndef __MONGODB_BSON_DOCUMENTREADER_H__
+#define __MONGODB_BSON_DOCUMENTREADER_H__
+
+#include "hphp/runtime/base/file.h"
+
+#include "../../../bson.h"
+
+extern "C" {
+#include "../../../libbson/src/bson/bson.h"
+}
+
+namespace HPHP {
+
+extern const StaticString s_MongoBsonDocumentReader_className;
+
+/* Iterates over a sequence of concatenated BSON documents, as found in
+ * mongodump's .bson files, one document at a time. The source is either a
+ * string or a stream resource; only one document is held in memory. */
+class MongoDBBsonDocumentReaderData
+{
+	public:
+		static Class* s_class;
+		static const StaticString s_className;
+
+		static Class* getClass();
+
+		bson_reader_t *m_reader = NULL;
+		String m_data;     /* keeps a string source alive */
+		Resource m_stream; /* keeps a stream source alive */
+		File *m_file = NULL;
+		hippo_bson_conversion_options_t m_options;
+
+		int64_t m_base_offset = 0;
+		int64_t m_offset = 0;
+		int64_t m_position = -1;
+		Variant m_current;
+		bool m_valid = false;
+
+		void sweep() {
+			if (m_reader) {
+				bson_reader_destroy(m_reader);
+				m_reader = NULL;
+			}
+		}
+
+		MongoDBBsonDocumentReaderData() {
+			m_options = HIPPO_TYPEMAP_INITIALIZER;
+		}
+
+		~MongoDBBsonDocumentReaderData() {
+			sweep();
+		};
+};
+
+Object createMongoBsonDocumentReaderObject(const Variant &source, const hippo_bson_conversion_options_t &options);
+
+Variant HHVM_METHOD(MongoDBBsonDocumentReader, current);
+int64_t HHVM_METHOD(MongoDBBsonDocumentReader, key);
+void HHVM_METHOD(MongoDBBsonDocumentReader, next);
+void HHVM_METHOD(MongoDBBsonDocumentReader, rewind);
+bool HHVM_METHOD(MongoDBBsonDocumentReader, valid);
+int64_t HHVM_METHOD(MongoDBBsonDocumentReader, tell);
+
+}
+#endif
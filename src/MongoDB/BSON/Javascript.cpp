@@ -17,6 +17,8 @@
 #include "hphp/runtime/ext/extension.h"
 #include "hphp/runtime/vm/native-data.h"
 
+#include "../../../mongodb.h"
+
 #include "Javascript.h"
 
 namespace HPHP {
@@ -24,5 +26,50 @@ namespace HPHP {
 const StaticString s_MongoBsonJavascript_className("MongoDB\\BSON\\Javascript");
 const StaticString s_MongoBsonJavascript_code("code");
 const StaticString s_MongoBsonJavascript_scope("scope");
+Class* MongoDBBsonJavascriptData::s_class = nullptr;
+const StaticString MongoDBBsonJavascriptData::s_className("MongoDBBsonJavascript");
+IMPLEMENT_GET_CLASS(MongoDBBsonJavascriptData);
+
+const StaticString s_MongoBsonJavascript_javascript("javascript");
+
+Object createMongoBsonJavascriptObject(const char *v_code, size_t v_code_len, const Variant &scope)
+{
+	static Class* c_code;
+	static Slot s_code_slot = kInvalidSlot, s_scope_slot = kInvalidSlot;
+	MongoDBBsonJavascriptData* data;
+
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_code, s_MongoBsonJavascript_className);
+	HIPPO_LOOKUP_SYSTEMLIB_PROP_SLOT(s_code_slot, c_code, s_MongoBsonJavascript_code);
+	HIPPO_LOOKUP_SYSTEMLIB_PROP_SLOT(s_scope_slot, c_code, s_MongoBsonJavascript_scope);
+	Object obj = Object{c_code};
+
+	data = Native::data<MongoDBBsonJavascriptData>(obj.get());
+	data->m_code = String(v_code, v_code_len, CopyString);
+	data->m_scope = scope;
+
+	tvAsVariant(&obj->propVec()[s_code_slot]) = data->m_code;
+	tvAsVariant(&obj->propVec()[s_scope_slot]) = scope;
+
+	return obj;
+}
+
+void HHVM_METHOD(MongoDBBsonJavascript, _init, const String &code, const Variant &scope)
+{
+	MongoDBBsonJavascriptData* data = Native::data<MongoDBBsonJavascriptData>(this_);
+
+	data->m_code = code;
+	data->m_scope = scope;
+}
+
+Array HHVM_METHOD(MongoDBBsonJavascript, __debugInfo)
+{
+	MongoDBBsonJavascriptData* data = Native::data<MongoDBBsonJavascriptData>(this_);
+	Array retval = Array::Create();
+
+	retval.set(s_MongoBsonJavascript_javascript, data->m_code);
+	retval.set(s_MongoBsonJavascript_scope, data->m_scope.toObject());
+
+	return retval;
+}
 
 }
@@ -21,6 +21,29 @@ extern const StaticString s_MongoBsonJavascript_className;
 extern const StaticString s_MongoBsonJavascript_code;
 extern const StaticString s_MongoBsonJavascript_scope;
 
+class MongoDBBsonJavascriptData
+{
+	public:
+		static Class* s_class;
+		static const StaticString s_className;
+
+		static Class* getClass();
+
+		String m_code;
+		Variant m_scope;
+
+		void sweep() {
+		}
+
+		~MongoDBBsonJavascriptData() {
+			sweep();
+		};
+};
+
+Object createMongoBsonJavascriptObject(const char *v_code, size_t v_code_len, const Variant &scope);
+
+void HHVM_METHOD(MongoDBBsonJavascript, _init, const String &code, const Variant &scope);
+Array HHVM_METHOD(MongoDBBsonJavascript, __debugInfo);
+
 }
 #endif
-
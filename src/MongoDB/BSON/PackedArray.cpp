@@ -0,0 +1,150 @@
+/**
+ *  Copyright 2014-2015 MongoDB, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "hphp/runtime/ext/extension.h"
+#include "hphp/runtime/vm/native-data.h"
+
+#include "../../../bson.h"
+#include "../../../mongodb.h"
+#include "../../../utils.h"
+
+#include "Document.h"
+#include "PackedArray.h"
+
+namespace HPHP {
+
+const StaticString s_MongoBsonPackedArray_className("MongoDB\\BSON\\PackedArray");
+Class* MongoDBBsonPackedArrayData::s_class = nullptr;
+const StaticString MongoDBBsonPackedArrayData::s_className("MongoDBBsonPackedArray");
+IMPLEMENT_GET_CLASS(MongoDBBsonPackedArrayData);
+
+Object createMongoBsonPackedArrayObject(const String &data, uint32_t offset, uint32_t length)
+{
+	static Class* c_packed_array;
+	MongoDBBsonPackedArrayData* obj_data;
+
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_packed_array, s_MongoBsonPackedArray_className);
+	Object obj = Object{c_packed_array};
+
+	obj_data = Native::data<MongoDBBsonPackedArrayData>(obj.get());
+	obj_data->m_data = data;
+	obj_data->m_offset = offset;
+	obj_data->m_length = length;
+	obj_data->m_cache = Array::Create();
+
+	return obj;
+}
+
+/* Positions the iterator on element 'index', whose key is its decimal
+ * representation */
+static bool hippo_bson_packed_array_find(MongoDBBsonPackedArrayData *data, int64_t index, bson_t *b, bson_iter_t *iter)
+{
+	char buffer[16];
+	const char *key;
+
+	if (index < 0 || index > UINT32_MAX) {
+		return false;
+	}
+
+	if (!hippo_bson_view_init(b, data->m_data, data->m_offset, data->m_length)) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Detected corrupt BSON data");
+	}
+
+	bson_uint32_to_string((uint32_t) index, &key, buffer, sizeof(buffer));
+
+	return bson_iter_init_find(iter, b, key);
+}
+
+void HHVM_METHOD(MongoDBBsonPackedArray, _init, const String &bson)
+{
+	MongoDBBsonPackedArrayData* data = Native::data<MongoDBBsonPackedArrayData>(this_);
+	bson_t b;
+	size_t err_offset;
+
+	if (!hippo_bson_view_init(&b, bson, 0, bson.size()) || !bson_validate(&b, BSON_VALIDATE_NONE, &err_offset)) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Could not read array from BSON reader");
+	}
+
+	data->m_data = bson;
+	data->m_offset = 0;
+	data->m_length = bson.size();
+	data->m_cache = Array::Create();
+}
+
+Variant HHVM_METHOD(MongoDBBsonPackedArray, get, int64_t index)
+{
+	MongoDBBsonPackedArrayData* data = Native::data<MongoDBBsonPackedArrayData>(this_);
+	bson_t b;
+	bson_iter_t iter;
+	Variant v;
+
+	if (data->m_cache.exists(index)) {
+		return data->m_cache[index];
+	}
+
+	if (!hippo_bson_packed_array_find(data, index, &b, &iter)) {
+		return Variant();
+	}
+
+	v = hippo_bson_view_element(data->m_data, &iter);
+	data->m_cache.set(index, v);
+
+	return v;
+}
+
+bool HHVM_METHOD(MongoDBBsonPackedArray, has, int64_t index)
+{
+	MongoDBBsonPackedArrayData* data = Native::data<MongoDBBsonPackedArrayData>(this_);
+	bson_t b;
+	bson_iter_t iter;
+
+	if (data->m_cache.exists(index)) {
+		return true;
+	}
+
+	return hippo_bson_packed_array_find(data, index, &b, &iter);
+}
+
+Array HHVM_METHOD(MongoDBBsonPackedArray, _elements)
+{
+	MongoDBBsonPackedArrayData* data = Native::data<MongoDBBsonPackedArrayData>(this_);
+
+	if (data->m_elements.isNull()) {
+		data->m_elements = hippo_bson_view_elements(data->m_data, data->m_offset, data->m_length, true, data->m_cache);
+	}
+
+	return data->m_elements.toArray();
+}
+
+Variant HHVM_METHOD(MongoDBBsonPackedArray, toPHP, const Variant &typemap)
+{
+	MongoDBBsonPackedArrayData* data = Native::data<MongoDBBsonPackedArrayData>(this_);
+
+	return hippo_bson_view_to_php(data->m_data, data->m_offset, data->m_length, HIPPO_BSONTYPE_ARRAY, typemap);
+}
+
+String HHVM_METHOD(MongoDBBsonPackedArray, __toString)
+{
+	MongoDBBsonPackedArrayData* data = Native::data<MongoDBBsonPackedArrayData>(this_);
+
+	if (data->m_offset == 0 && data->m_length == (uint32_t) data->m_data.size()) {
+		return data->m_data;
+	}
+
+	return String(data->m_data.data() + data->m_offset, data->m_length, CopyString);
+}
+
+}
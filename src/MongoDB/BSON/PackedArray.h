@@ -0,0 +1,55 @@
+/**
+ *  Copyright 2014-2015 MongoDB, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+#ifndef __MONGODB_BSON_PACKEDARRAY_H__
+#define __MONGODB_BSON_PACKEDARRAY_H__
+namespace HPHP {
+
+extern const StaticString s_MongoBsonPackedArray_className;
+
+/* The array counterpart of MongoDBBsonDocumentData */
+class MongoDBBsonPackedArrayData
+{
+	public:
+		static Class* s_class;
+		static const StaticString s_className;
+
+		static Class* getClass();
+
+		String m_data;
+		uint32_t m_offset;
+		uint32_t m_length;
+		Array m_cache;
+		Variant m_elements; /* all elements, once they have been iterated over */
+
+		void sweep() {
+		}
+
+		~MongoDBBsonPackedArrayData() {
+			sweep();
+		};
+};
+
+Object createMongoBsonPackedArrayObject(const String &data, uint32_t offset, uint32_t length);
+
+void HHVM_METHOD(MongoDBBsonPackedArray, _init, const String &bson);
+Variant HHVM_METHOD(MongoDBBsonPackedArray, get, int64_t index);
+bool HHVM_METHOD(MongoDBBsonPackedArray, has, int64_t index);
+Array HHVM_METHOD(MongoDBBsonPackedArray, _elements);
+Variant HHVM_METHOD(MongoDBBsonPackedArray, toPHP, const Variant &typemap);
+String HHVM_METHOD(MongoDBBsonPackedArray, __toString);
+
+}
+#endif
@@ -17,6 +17,8 @@
 #include "hphp/runtime/ext/extension.h"
 #include "hphp/runtime/vm/native-data.h"
 
+#include "../../../mongodb.h"
+
 #include "Regex.h"
 
 namespace HPHP {
@@ -24,5 +26,69 @@ namespace HPHP {
 const StaticString s_MongoBsonRegex_className("MongoDB\\BSON\\Regex");
 const StaticString s_MongoBsonRegex_pattern("pattern");
 const StaticString s_MongoBsonRegex_flags("flags");
+Class* MongoDBBsonRegexData::s_class = nullptr;
+const StaticString MongoDBBsonRegexData::s_className("MongoDBBsonRegex");
+IMPLEMENT_GET_CLASS(MongoDBBsonRegexData);
+
+Object createMongoBsonRegexObject(const char *v_regex, const char *v_options)
+{
+	static Class* c_regex;
+	static Slot s_pattern_slot = kInvalidSlot, s_flags_slot = kInvalidSlot;
+	MongoDBBsonRegexData* data;
+
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_regex, s_MongoBsonRegex_className);
+	HIPPO_LOOKUP_SYSTEMLIB_PROP_SLOT(s_pattern_slot, c_regex, s_MongoBsonRegex_pattern);
+	HIPPO_LOOKUP_SYSTEMLIB_PROP_SLOT(s_flags_slot, c_regex, s_MongoBsonRegex_flags);
+	Object obj = Object{c_regex};
+
+	data = Native::data<MongoDBBsonRegexData>(obj.get());
+	data->m_pattern = String(v_regex, CopyString);
+	data->m_flags = String(v_options, CopyString);
+
+	tvAsVariant(&obj->propVec()[s_pattern_slot]) = data->m_pattern;
+	tvAsVariant(&obj->propVec()[s_flags_slot]) = data->m_flags;
+
+	return obj;
+}
+
+void HHVM_METHOD(MongoDBBsonRegex, _init, const String &pattern, const String &flags)
+{
+	MongoDBBsonRegexData* data = Native::data<MongoDBBsonRegexData>(this_);
+
+	data->m_pattern = pattern;
+	data->m_flags = flags;
+}
+
+String HHVM_METHOD(MongoDBBsonRegex, getPattern)
+{
+	MongoDBBsonRegexData* data = Native::data<MongoDBBsonRegexData>(this_);
+
+	return data->m_pattern;
+}
+
+String HHVM_METHOD(MongoDBBsonRegex, getFlags)
+{
+	MongoDBBsonRegexData* data = Native::data<MongoDBBsonRegexData>(this_);
+
+	return data->m_flags;
+}
+
+String HHVM_METHOD(MongoDBBsonRegex, __toString)
+{
+	MongoDBBsonRegexData* data = Native::data<MongoDBBsonRegexData>(this_);
+
+	return "/" + data->m_pattern + "/" + data->m_flags;
+}
+
+Array HHVM_METHOD(MongoDBBsonRegex, __debugInfo)
+{
+	MongoDBBsonRegexData* data = Native::data<MongoDBBsonRegexData>(this_);
+	Array retval = Array::Create();
+
+	retval.set(s_MongoBsonRegex_pattern, data->m_pattern);
+	retval.set(s_MongoBsonRegex_flags, data->m_flags);
+
+	return retval;
+}
 
 }
@@ -21,6 +21,32 @@ extern const StaticString s_MongoBsonRegex_className;
 extern const StaticString s_MongoBsonRegex_pattern;
 extern const StaticString s_MongoBsonRegex_flags;
 
+class MongoDBBsonRegexData
+{
+	public:
+		static Class* s_class;
+		static const StaticString s_className;
+
+		static Class* getClass();
+
+		String m_pattern;
+		String m_flags;
+
+		void sweep() {
+		}
+
+		~MongoDBBsonRegexData() {
+			sweep();
+		};
+};
+
+Object createMongoBsonRegexObject(const char *v_regex, const char *v_options);
+
+void HHVM_METHOD(MongoDBBsonRegex, _init, const String &pattern, const String &flags);
+String HHVM_METHOD(MongoDBBsonRegex, getPattern);
+String HHVM_METHOD(MongoDBBsonRegex, getFlags);
+String HHVM_METHOD(MongoDBBsonRegex, __toString);
+Array HHVM_METHOD(MongoDBBsonRegex, __debugInfo);
+
 }
 #endif
-
@@ -17,6 +17,10 @@
 #include "hphp/runtime/ext/extension.h"
 #include "hphp/runtime/vm/native-data.h"
 
+#include <cinttypes>
+
+#include "../../../mongodb.h"
+
 #include "Timestamp.h"
 
 namespace HPHP {
@@ -24,5 +28,59 @@ namespace HPHP {
 const StaticString s_MongoBsonTimestamp_className("MongoDB\\BSON\\Timestamp");
 const StaticString s_MongoBsonTimestamp_timestamp("timestamp");
 const StaticString s_MongoBsonTimestamp_increment("increment");
+Class* MongoDBBsonTimestampData::s_class = nullptr;
+const StaticString MongoDBBsonTimestampData::s_className("MongoDBBsonTimestamp");
+IMPLEMENT_GET_CLASS(MongoDBBsonTimestampData);
+
+Object createMongoBsonTimestampObject(uint32_t v_timestamp, uint32_t v_increment)
+{
+	static Class* c_timestamp;
+	static Slot s_increment_slot = kInvalidSlot, s_timestamp_slot = kInvalidSlot;
+	MongoDBBsonTimestampData* data;
+
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_timestamp, s_MongoBsonTimestamp_className);
+	HIPPO_LOOKUP_SYSTEMLIB_PROP_SLOT(s_increment_slot, c_timestamp, s_MongoBsonTimestamp_increment);
+	HIPPO_LOOKUP_SYSTEMLIB_PROP_SLOT(s_timestamp_slot, c_timestamp, s_MongoBsonTimestamp_timestamp);
+	Object obj = Object{c_timestamp};
+
+	data = Native::data<MongoDBBsonTimestampData>(obj.get());
+	data->m_timestamp = v_timestamp;
+	data->m_increment = v_increment;
+
+	tvAsVariant(&obj->propVec()[s_increment_slot]) = (int64_t) v_increment;
+	tvAsVariant(&obj->propVec()[s_timestamp_slot]) = (int64_t) v_timestamp;
+
+	return obj;
+}
+
+void HHVM_METHOD(MongoDBBsonTimestamp, _init, int64_t increment, int64_t timestamp)
+{
+	MongoDBBsonTimestampData* data = Native::data<MongoDBBsonTimestampData>(this_);
+
+	data->m_increment = (uint32_t) increment;
+	data->m_timestamp = (uint32_t) timestamp;
+}
+
+String HHVM_METHOD(MongoDBBsonTimestamp, __toString)
+{
+	MongoDBBsonTimestampData* data = Native::data<MongoDBBsonTimestampData>(this_);
+	char buffer[24];
+	int length;
+
+	length = snprintf(buffer, sizeof(buffer), "[%" PRIu32 ":%" PRIu32 "]", data->m_increment, data->m_timestamp);
+
+	return String(buffer, length, CopyString);
+}
+
+Array HHVM_METHOD(MongoDBBsonTimestamp, __debugInfo)
+{
+	MongoDBBsonTimestampData* data = Native::data<MongoDBBsonTimestampData>(this_);
+	Array retval = Array::Create();
+
+	retval.set(s_MongoBsonTimestamp_increment, (int64_t) data->m_increment);
+	retval.set(s_MongoBsonTimestamp_timestamp, (int64_t) data->m_timestamp);
+
+	return retval;
+}
 
 }
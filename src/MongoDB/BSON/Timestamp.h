@@ -21,6 +21,30 @@ extern const StaticString s_MongoBsonTimestamp_className;
 extern const StaticString s_MongoBsonTimestamp_timestamp;
 extern const StaticString s_MongoBsonTimestamp_increment;
 
+class MongoDBBsonTimestampData
+{
+	public:
+		static Class* s_class;
+		static const StaticString s_className;
+
+		static Class* getClass();
+
+		uint32_t m_increment;
+		uint32_t m_timestamp;
+
+		void sweep() {
+		}
+
+		~MongoDBBsonTimestampData() {
+			sweep();
+		};
+};
+
+Object createMongoBsonTimestampObject(uint32_t v_timestamp, uint32_t v_increment);
+
+void HHVM_METHOD(MongoDBBsonTimestamp, _init, int64_t increment, int64_t timestamp);
+String HHVM_METHOD(MongoDBBsonTimestamp, __toString);
+Array HHVM_METHOD(MongoDBBsonTimestamp, __debugInfo);
+
 }
 #endif
-
@@ -27,12 +27,58 @@ namespace HPHP {
 const StaticString s_MongoBsonUTCDateTime_className("MongoDB\\BSON\\UTCDateTime");
 
 const StaticString s_MongoBsonUTCDateTime_milliseconds("milliseconds");
+Class* MongoDBBsonUTCDateTimeData::s_class = nullptr;
+const StaticString MongoDBBsonUTCDateTimeData::s_className("MongoDBBsonUTCDateTime");
+IMPLEMENT_GET_CLASS(MongoDBBsonUTCDateTimeData);
 
 const StaticString s_DateTime("DateTime");
 
+Object createMongoBsonUTCDateTimeObject(int64_t milliseconds)
+{
+	static Class* c_datetime;
+	static Slot s_milliseconds_slot = kInvalidSlot;
+	MongoDBBsonUTCDateTimeData* data;
+
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_datetime, s_MongoBsonUTCDateTime_className);
+	HIPPO_LOOKUP_SYSTEMLIB_PROP_SLOT(s_milliseconds_slot, c_datetime, s_MongoBsonUTCDateTime_milliseconds);
+	Object obj = Object{c_datetime};
+
+	data = Native::data<MongoDBBsonUTCDateTimeData>(obj.get());
+	data->m_milliseconds = milliseconds;
+
+	tvAsVariant(&obj->propVec()[s_milliseconds_slot]) = milliseconds;
+
+	return obj;
+}
+
+void HHVM_METHOD(MongoDBBsonUTCDateTime, _init, int64_t milliseconds)
+{
+	MongoDBBsonUTCDateTimeData* data = Native::data<MongoDBBsonUTCDateTimeData>(this_);
+
+	data->m_milliseconds = milliseconds;
+}
+
+String HHVM_METHOD(MongoDBBsonUTCDateTime, __toString)
+{
+	MongoDBBsonUTCDateTimeData* data = Native::data<MongoDBBsonUTCDateTimeData>(this_);
+
+	return String(data->m_milliseconds);
+}
+
+Array HHVM_METHOD(MongoDBBsonUTCDateTime, __debugInfo)
+{
+	MongoDBBsonUTCDateTimeData* data = Native::data<MongoDBBsonUTCDateTimeData>(this_);
+	Array retval = Array::Create();
+
+	retval.set(s_MongoBsonUTCDateTime_milliseconds, data->m_milliseconds);
+
+	return retval;
+}
+
 Object HHVM_METHOD(MongoDBBsonUTCDateTime, toDateTime)
 {
-	int64_t milliseconds = this_->o_get(s_MongoBsonUTCDateTime_milliseconds, false, s_MongoBsonUTCDateTime_className).toInt64();
+	MongoDBBsonUTCDateTimeData* obj_data = Native::data<MongoDBBsonUTCDateTimeData>(this_);
+	int64_t milliseconds = obj_data->m_milliseconds;
 
 	/* Prepare result */
 	HPHP::Object obj{DateTimeData::getClass()};
@@ -20,6 +20,29 @@ namespace HPHP {
 extern const StaticString s_MongoBsonUTCDateTime_className;
 extern const StaticString s_MongoBsonUTCDateTime_milliseconds;
 
+class MongoDBBsonUTCDateTimeData
+{
+	public:
+		static Class* s_class;
+		static const StaticString s_className;
+
+		static Class* getClass();
+
+		int64_t m_milliseconds;
+
+		void sweep() {
+		}
+
+		~MongoDBBsonUTCDateTimeData() {
+			sweep();
+		};
+};
+
+Object createMongoBsonUTCDateTimeObject(int64_t milliseconds);
+
+void HHVM_METHOD(MongoDBBsonUTCDateTime, _init, int64_t milliseconds);
+String HHVM_METHOD(MongoDBBsonUTCDateTime, __toString);
+Array HHVM_METHOD(MongoDBBsonUTCDateTime, __debugInfo);
 Object HHVM_METHOD(MongoDBBsonUTCDateTime, toDateTime);
 }
 #endif
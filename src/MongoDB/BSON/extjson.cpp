@@ -0,0 +1,1712 @@
+/**
+ *  Copyright 2014-2015 MongoDB, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "hphp/runtime/ext/extension.h"
+#include "hphp/runtime/base/string-buffer.h"
+
+#include "../../../utils.h"
+
+#include "extjson.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <ctime>
+#include <string>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+extern "C" {
+#include "../../../libbson/src/bson/bson.h"
+}
+
+namespace HPHP {
+
+/* The writer walks the document with bson_iter_next() and appends straight
+ * into one StringBuffer, so that the only allocation is the buffer itself
+ * (and its growth). The layout matches libbson's own JSON output. */
+
+static void hippo_extjson_write_document(StringBuffer &buf, bson_iter_t *iter, int mode, bool is_array);
+
+static void hippo_extjson_fail()
+{
+	throw MongoDriver::Utils::throwUnexpectedValueException("Could not convert BSON document to a JSON string");
+}
+
+/* {{{ Scanning strings
+ *
+ * Both directions spend most of their time on runs of string characters
+ * that need no escaping. With SSE2, which every x86-64 CPU has, those runs
+ * are scanned 16 bytes at a time. */
+
+/* Returns the first quote, backslash, or control character in [p, end), or
+ * 'end' if there is none */
+static inline const char *hippo_extjson_scan_plain(const char *p, const char *end)
+{
+#if defined(__SSE2__)
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i control_max = _mm_set1_epi8(0x1f);
+
+	while (end - p >= 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*) p);
+		__m128i special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+			_mm_cmpeq_epi8(_mm_max_epu8(chunk, control_max), control_max)
+		);
+		int mask = _mm_movemask_epi8(special);
+
+		if (mask) {
+			return p + __builtin_ctz(mask);
+		}
+		p += 16;
+	}
+#endif
+
+	while (p < end && (unsigned char) *p >= 0x20 && *p != '"' && *p != '\\') {
+		p++;
+	}
+
+	return p;
+}
+/* }}} */
+
+/* {{{ Scalars */
+static const char hippo_extjson_hex[] = "0123456789abcdef";
+
+/* Copies runs of characters that need no escaping in one go, which is the
+ * common case for keys and most string values */
+static void hippo_extjson_write_string(StringBuffer &buf, const char *str, size_t len)
+{
+	const char *p = str;
+	const char *end = str + len;
+
+	if (!bson_utf8_validate(str, len, true)) {
+		hippo_extjson_fail();
+	}
+
+	buf.append('"');
+
+	for (;;) {
+		const char *run = hippo_extjson_scan_plain(p, end);
+
+		buf.append(p, run - p);
+		if (run == end) {
+			break;
+		}
+		p = run + 1;
+
+		switch (*run) {
+			case '"':  buf.append("\\\"", 2); break;
+			case '\\': buf.append("\\\\", 2); break;
+			case '\b': buf.append("\\b", 2); break;
+			case '\f': buf.append("\\f", 2); break;
+			case '\n': buf.append("\\n", 2); break;
+			case '\r': buf.append("\\r", 2); break;
+			case '\t': buf.append("\\t", 2); break;
+			default: {
+				unsigned char c = (unsigned char) *run;
+				char escape[6] = { '\\', 'u', '0', '0', hippo_extjson_hex[c >> 4], hippo_extjson_hex[c & 0x0f] };
+
+				buf.append(escape, 6);
+			}
+		}
+	}
+
+	buf.append('"');
+}
+
+static void hippo_extjson_write_int64(StringBuffer &buf, int64_t v)
+{
+	char tmp[24];
+	int len = snprintf(tmp, sizeof(tmp), "%" PRId64, v);
+
+	buf.append(tmp, len);
+}
+
+static void hippo_extjson_write_quoted_int64(StringBuffer &buf, int64_t v)
+{
+	buf.append('"');
+	hippo_extjson_write_int64(buf, v);
+	buf.append('"');
+}
+
+/* Uses the shortest representation that reads back as the same double, and
+ * makes sure that integral values still look like a double ("1.0") */
+static void hippo_extjson_write_double_repr(StringBuffer &buf, double v)
+{
+	char tmp[32];
+	int len = 0;
+
+	for (int precision = 15; precision <= 17; precision++) {
+		len = snprintf(tmp, sizeof(tmp), "%.*g", precision, v);
+
+		if (strtod(tmp, NULL) == v) {
+			break;
+		}
+	}
+
+	buf.append(tmp, len);
+
+	if (!strpbrk(tmp, ".eE")) {
+		buf.append(".0", 2);
+	}
+}
+
+static void hippo_extjson_write_double(StringBuffer &buf, double v, int mode)
+{
+	if (std::isnan(v)) {
+		buf.append("{ \"$numberDouble\" : \"NaN\" }");
+	} else if (std::isinf(v)) {
+		buf.append(v > 0 ? "{ \"$numberDouble\" : \"Infinity\" }" : "{ \"$numberDouble\" : \"-Infinity\" }");
+	} else if (mode == HIPPO_EXTJSON_RELAXED) {
+		hippo_extjson_write_double_repr(buf, v);
+	} else {
+		buf.append("{ \"$numberDouble\" : \"");
+		hippo_extjson_write_double_repr(buf, v);
+		buf.append("\" }");
+	}
+}
+
+static void hippo_extjson_write_base64(StringBuffer &buf, const uint8_t *data, uint32_t len)
+{
+	static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	char out[4];
+	uint32_t i;
+
+	for (i = 0; i + 2 < len; i += 3) {
+		out[0] = alphabet[data[i] >> 2];
+		out[1] = alphabet[((data[i] & 0x03) << 4) | (data[i + 1] >> 4)];
+		out[2] = alphabet[((data[i + 1] & 0x0f) << 2) | (data[i + 2] >> 6)];
+		out[3] = alphabet[data[i + 2] & 0x3f];
+		buf.append(out, 4);
+	}
+
+	if (i < len) {
+		out[0] = alphabet[data[i] >> 2];
+		if (i + 1 < len) {
+			out[1] = alphabet[((data[i] & 0x03) << 4) | (data[i + 1] >> 4)];
+			out[2] = alphabet[(data[i + 1] & 0x0f) << 2];
+		} else {
+			out[1] = alphabet[(data[i] & 0x03) << 4];
+			out[2] = '=';
+		}
+		out[3] = '=';
+		buf.append(out, 4);
+	}
+}
+
+static void hippo_extjson_write_oid(StringBuffer &buf, const bson_oid_t *oid)
+{
+	char str[25];
+
+	bson_oid_to_string(oid, str);
+
+	buf.append("{ \"$oid\" : \"");
+	buf.append(str, 24);
+	buf.append("\" }");
+}
+
+/* Relaxed mode writes dates between the years 1970 and 9999 as ISO-8601
+ * strings, and everything else in the canonical form */
+static void hippo_extjson_write_date_time(StringBuffer &buf, int64_t msec, int mode)
+{
+	if (mode == HIPPO_EXTJSON_RELAXED && msec >= 0 && msec <= INT64_C(253402300799999)) {
+		time_t secs = (time_t) (msec / 1000);
+		int millis = (int) (msec % 1000);
+		struct tm tm;
+		char tmp[32];
+		int len;
+
+		gmtime_r(&secs, &tm);
+		len = strftime(tmp, sizeof(tmp), "%Y-%m-%dT%H:%M:%S", &tm);
+		if (millis) {
+			len += snprintf(tmp + len, sizeof(tmp) - len, ".%03d", millis);
+		}
+
+		buf.append("{ \"$date\" : \"");
+		buf.append(tmp, len);
+		buf.append("Z\" }");
+		return;
+	}
+
+	buf.append("{ \"$date\" : { \"$numberLong\" : ");
+	hippo_extjson_write_quoted_int64(buf, msec);
+	buf.append(" } }");
+}
+/* }}} */
+
+static void hippo_extjson_write_value(StringBuffer &buf, bson_iter_t *iter, int mode)
+{
+	switch (bson_iter_type(iter)) {
+		case BSON_TYPE_DOUBLE:
+			hippo_extjson_write_double(buf, bson_iter_double(iter), mode);
+			break;
+
+		case BSON_TYPE_UTF8: {
+			uint32_t len;
+			const char *str = bson_iter_utf8(iter, &len);
+
+			hippo_extjson_write_string(buf, str, len);
+			break;
+		}
+
+		case BSON_TYPE_DOCUMENT:
+		case BSON_TYPE_ARRAY: {
+			bson_iter_t child;
+
+			if (!bson_iter_recurse(iter, &child)) {
+				hippo_extjson_fail();
+			}
+			hippo_extjson_write_document(buf, &child, mode, bson_iter_type(iter) == BSON_TYPE_ARRAY);
+			break;
+		}
+
+		case BSON_TYPE_BINARY: {
+			bson_subtype_t subtype;
+			uint32_t len;
+			const uint8_t *data;
+			char subtype_hex[2];
+
+			bson_iter_binary(iter, &subtype, &len, &data);
+			subtype_hex[0] = hippo_extjson_hex[(subtype >> 4) & 0x0f];
+			subtype_hex[1] = hippo_extjson_hex[subtype & 0x0f];
+
+			buf.append("{ \"$binary\" : { \"base64\" : \"");
+			hippo_extjson_write_base64(buf, data, len);
+			buf.append("\", \"subType\" : \"");
+			buf.append(subtype_hex, 2);
+			buf.append("\" } }");
+			break;
+		}
+
+		case BSON_TYPE_UNDEFINED:
+			buf.append("{ \"$undefined\" : true }");
+			break;
+
+		case BSON_TYPE_OID:
+			hippo_extjson_write_oid(buf, bson_iter_oid(iter));
+			break;
+
+		case BSON_TYPE_BOOL:
+			if (bson_iter_bool(iter)) {
+				buf.append("true", 4);
+			} else {
+				buf.append("false", 5);
+			}
+			break;
+
+		case BSON_TYPE_DATE_TIME:
+			hippo_extjson_write_date_time(buf, bson_iter_date_time(iter), mode);
+			break;
+
+		case BSON_TYPE_NULL:
+			buf.append("null", 4);
+			break;
+
+		case BSON_TYPE_REGEX: {
+			const char *options;
+			const char *pattern = bson_iter_regex(iter, &options);
+			std::string sorted_options(options);
+
+			/* Extended JSON v2 wants the options in alphabetical order */
+			std::sort(sorted_options.begin(), sorted_options.end());
+
+			buf.append("{ \"$regularExpression\" : { \"pattern\" : ");
+			hippo_extjson_write_string(buf, pattern, strlen(pattern));
+			buf.append(", \"options\" : ");
+			hippo_extjson_write_string(buf, sorted_options.data(), sorted_options.size());
+			buf.append(" } }");
+			break;
+		}
+
+		case BSON_TYPE_DBPOINTER: {
+			uint32_t len;
+			const char *collection;
+			const bson_oid_t *oid;
+
+			bson_iter_dbpointer(iter, &len, &collection, &oid);
+
+			buf.append("{ \"$dbPointer\" : { \"$ref\" : ");
+			hippo_extjson_write_string(buf, collection, len);
+			buf.append(", \"$id\" : ");
+			hippo_extjson_write_oid(buf, oid);
+			buf.append(" } }");
+			break;
+		}
+
+		case BSON_TYPE_CODE: {
+			uint32_t len;
+			const char *code = bson_iter_code(iter, &len);
+
+			buf.append("{ \"$code\" : ");
+			hippo_extjson_write_string(buf, code, len);
+			buf.append(" }");
+			break;
+		}
+
+		case BSON_TYPE_SYMBOL: {
+			uint32_t len;
+			const char *symbol = bson_iter_symbol(iter, &len);
+
+			buf.append("{ \"$symbol\" : ");
+			hippo_extjson_write_string(buf, symbol, len);
+			buf.append(" }");
+			break;
+		}
+
+		case BSON_TYPE_CODEWSCOPE: {
+			uint32_t len;
+			uint32_t scope_len;
+			const uint8_t *scope_data;
+			const char *code = bson_iter_codewscope(iter, &len, &scope_len, &scope_data);
+			bson_t scope;
+			bson_iter_t child;
+
+			if (!bson_init_static(&scope, scope_data, scope_len) || !bson_iter_init(&child, &scope)) {
+				hippo_extjson_fail();
+			}
+
+			buf.append("{ \"$code\" : ");
+			hippo_extjson_write_string(buf, code, len);
+			buf.append(", \"$scope\" : ");
+			hippo_extjson_write_document(buf, &child, mode, false);
+			buf.append(" }");
+			break;
+		}
+
+		case BSON_TYPE_INT32:
+			if (mode == HIPPO_EXTJSON_RELAXED) {
+				hippo_extjson_write_int64(buf, bson_iter_int32(iter));
+			} else {
+				buf.append("{ \"$numberInt\" : ");
+				hippo_extjson_write_quoted_int64(buf, bson_iter_int32(iter));
+				buf.append(" }");
+			}
+			break;
+
+		case BSON_TYPE_TIMESTAMP: {
+			uint32_t timestamp;
+			uint32_t increment;
+
+			bson_iter_timestamp(iter, &timestamp, &increment);
+
+			buf.append("{ \"$timestamp\" : { \"t\" : ");
+			hippo_extjson_write_int64(buf, timestamp);
+			buf.append(", \"i\" : ");
+			hippo_extjson_write_int64(buf, increment);
+			buf.append(" } }");
+			break;
+		}
+
+		case BSON_TYPE_INT64:
+			if (mode == HIPPO_EXTJSON_RELAXED) {
+				hippo_extjson_write_int64(buf, bson_iter_int64(iter));
+			} else {
+				buf.append("{ \"$numberLong\" : ");
+				hippo_extjson_write_quoted_int64(buf, bson_iter_int64(iter));
+				buf.append(" }");
+			}
+			break;
+
+		case BSON_TYPE_DECIMAL128: {
+			bson_decimal128_t decimal;
+			char str[BSON_DECIMAL128_STRING];
+
+			bson_iter_decimal128(iter, &decimal);
+			bson_decimal128_to_string(&decimal, str);
+
+			buf.append("{ \"$numberDecimal\" : \"");
+			buf.append(str);
+			buf.append("\" }");
+			break;
+		}
+
+		case BSON_TYPE_MAXKEY:
+			buf.append("{ \"$maxKey\" : 1 }");
+			break;
+
+		case BSON_TYPE_MINKEY:
+			buf.append("{ \"$minKey\" : 1 }");
+			break;
+
+		default:
+			hippo_extjson_fail();
+	}
+}
+
+static void hippo_extjson_write_document(StringBuffer &buf, bson_iter_t *iter, int mode, bool is_array)
+{
+	bool first = true;
+
+	buf.append(is_array ? "[ " : "{ ", 2);
+
+	while (bson_iter_next(iter)) {
+		if (!first) {
+			buf.append(", ", 2);
+		}
+		first = false;
+
+		if (!is_array) {
+			const char *key = bson_iter_key(iter);
+
+			hippo_extjson_write_string(buf, key, strlen(key));
+			buf.append(" : ", 3);
+		}
+
+		hippo_extjson_write_value(buf, iter, mode);
+	}
+
+	if (iter->err_off) {
+		hippo_extjson_fail();
+	}
+
+	if (first) {
+		buf.append(is_array ? "]" : "}", 1);
+	} else {
+		buf.append(is_array ? " ]" : " }", 2);
+	}
+}
+
+String hippo_bson_to_extended_json(const String &data, int mode)
+{
+	bson_t b;
+	bson_iter_t iter;
+	uint32_t len_le;
+	uint32_t len = 0;
+
+	if (data.size() >= 5) {
+		memcpy(&len_le, data.data(), sizeof(len_le));
+		len = BSON_UINT32_FROM_LE(len_le);
+	}
+
+	if (len < 5 || len > (uint32_t) data.size() || !bson_init_static(&b, (const uint8_t*) data.data(), len) || !bson_iter_init(&iter, &b)) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Could not read document from BSON reader");
+	}
+
+	if (len != (uint32_t) data.size()) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Reading document did not exhaust input buffer");
+	}
+
+	/* JSON is nearly always larger than the BSON it came from */
+	StringBuffer buf(len * 2);
+
+	hippo_extjson_write_document(buf, &iter, mode, false);
+
+	return buf.detach();
+}
+
+
+/* {{{ Parser
+ *
+ * A recursive descent parser for (Extended) JSON that appends straight into
+ * a bson_t, so that documents and arrays are built in place and strings
+ * without escapes are never copied. Objects that start with a "$" key are
+ * looked at first, to see whether they are one of the Extended JSON type
+ * wrappers; both the v2 and the legacy forms are understood. Everything
+ * else, such as {"$type": "string"} in a query, stays a plain document. */
+#define HIPPO_EXTJSON_MAX_DEPTH 100
+
+typedef struct {
+	const char  *start;
+	const char  *p;
+	const char  *end;
+	int          depth;
+	std::string  key;   /* unescaped keys */
+	std::string  value; /* unescaped string values */
+} hippo_extjson_parser_t;
+
+/* Keys of the type wrappers, as bits so that the lookahead can tell which
+ * combination an object has */
+#define HIPPO_EXTJSON_KEY_OID                (1 << 0)
+#define HIPPO_EXTJSON_KEY_BINARY             (1 << 1)
+#define HIPPO_EXTJSON_KEY_TYPE               (1 << 2)
+#define HIPPO_EXTJSON_KEY_DATE               (1 << 3)
+#define HIPPO_EXTJSON_KEY_NUMBER_LONG        (1 << 4)
+#define HIPPO_EXTJSON_KEY_NUMBER_INT         (1 << 5)
+#define HIPPO_EXTJSON_KEY_NUMBER_DOUBLE      (1 << 6)
+#define HIPPO_EXTJSON_KEY_NUMBER_DECIMAL     (1 << 7)
+#define HIPPO_EXTJSON_KEY_REGEX              (1 << 8)
+#define HIPPO_EXTJSON_KEY_OPTIONS            (1 << 9)
+#define HIPPO_EXTJSON_KEY_REGULAR_EXPRESSION (1 << 10)
+#define HIPPO_EXTJSON_KEY_TIMESTAMP          (1 << 11)
+#define HIPPO_EXTJSON_KEY_MINKEY             (1 << 12)
+#define HIPPO_EXTJSON_KEY_MAXKEY             (1 << 13)
+#define HIPPO_EXTJSON_KEY_UNDEFINED          (1 << 14)
+#define HIPPO_EXTJSON_KEY_CODE               (1 << 15)
+#define HIPPO_EXTJSON_KEY_SCOPE              (1 << 16)
+#define HIPPO_EXTJSON_KEY_SYMBOL             (1 << 17)
+#define HIPPO_EXTJSON_KEY_DBPOINTER          (1 << 18)
+
+static const struct {
+	const char *name;
+	int         bit;
+} hippo_extjson_keys[] = {
+	{ "$oid", HIPPO_EXTJSON_KEY_OID },
+	{ "$binary", HIPPO_EXTJSON_KEY_BINARY },
+	{ "$type", HIPPO_EXTJSON_KEY_TYPE },
+	{ "$date", HIPPO_EXTJSON_KEY_DATE },
+	{ "$numberLong", HIPPO_EXTJSON_KEY_NUMBER_LONG },
+	{ "$numberInt", HIPPO_EXTJSON_KEY_NUMBER_INT },
+	{ "$numberDouble", HIPPO_EXTJSON_KEY_NUMBER_DOUBLE },
+	{ "$numberDecimal", HIPPO_EXTJSON_KEY_NUMBER_DECIMAL },
+	{ "$regex", HIPPO_EXTJSON_KEY_REGEX },
+	{ "$options", HIPPO_EXTJSON_KEY_OPTIONS },
+	{ "$regularExpression", HIPPO_EXTJSON_KEY_REGULAR_EXPRESSION },
+	{ "$timestamp", HIPPO_EXTJSON_KEY_TIMESTAMP },
+	{ "$minKey", HIPPO_EXTJSON_KEY_MINKEY },
+	{ "$maxKey", HIPPO_EXTJSON_KEY_MAXKEY },
+	{ "$undefined", HIPPO_EXTJSON_KEY_UNDEFINED },
+	{ "$code", HIPPO_EXTJSON_KEY_CODE },
+	{ "$scope", HIPPO_EXTJSON_KEY_SCOPE },
+	{ "$symbol", HIPPO_EXTJSON_KEY_SYMBOL },
+	{ "$dbPointer", HIPPO_EXTJSON_KEY_DBPOINTER },
+};
+
+static int hippo_extjson_key_bit(const char *key, size_t key_len)
+{
+	for (size_t i = 0; i < sizeof(hippo_extjson_keys) / sizeof(hippo_extjson_keys[0]); i++) {
+		if (strlen(hippo_extjson_keys[i].name) == key_len && memcmp(hippo_extjson_keys[i].name, key, key_len) == 0) {
+			return hippo_extjson_keys[i].bit;
+		}
+	}
+
+	return 0;
+}
+
+static void hippo_extjson_parse_error(hippo_extjson_parser_t *parser, const char *message)
+{
+	throw MongoDriver::Utils::throwUnexpectedValueException(
+		String("Error parsing JSON at position ") + String((int64_t) (parser->p - parser->start)) + ": " + message
+	);
+}
+
+static inline const char *hippo_extjson_skip_ws(const char *p, const char *end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+		p++;
+	}
+
+	return p;
+}
+
+static inline void hippo_extjson_expect(hippo_extjson_parser_t *parser, char c)
+{
+	parser->p = hippo_extjson_skip_ws(parser->p, parser->end);
+
+	if (parser->p >= parser->end || *parser->p != c) {
+		char message[] = "Expected 'x'";
+
+		message[10] = c;
+		hippo_extjson_parse_error(parser, message);
+	}
+	parser->p++;
+}
+
+/* Returns whether the next token is 'c', and skips over it if it is */
+static inline bool hippo_extjson_accept(hippo_extjson_parser_t *parser, char c)
+{
+	parser->p = hippo_extjson_skip_ws(parser->p, parser->end);
+
+	if (parser->p < parser->end && *parser->p == c) {
+		parser->p++;
+		return true;
+	}
+
+	return false;
+}
+
+static inline bool hippo_extjson_peek(hippo_extjson_parser_t *parser, char c)
+{
+	parser->p = hippo_extjson_skip_ws(parser->p, parser->end);
+
+	return parser->p < parser->end && *parser->p == c;
+}
+
+/* {{{ Strings */
+static int hippo_extjson_hex_value(char c)
+{
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+	if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+
+	return -1;
+}
+
+static uint32_t hippo_extjson_parse_hex4(hippo_extjson_parser_t *parser, const char *p)
+{
+	uint32_t v = 0;
+
+	if (parser->end - p < 4) {
+		hippo_extjson_parse_error(parser, "Invalid \\u escape");
+	}
+
+	for (int i = 0; i < 4; i++) {
+		int digit = hippo_extjson_hex_value(p[i]);
+
+		if (digit < 0) {
+			hippo_extjson_parse_error(parser, "Invalid \\u escape");
+		}
+		v = (v << 4) | digit;
+	}
+
+	return v;
+}
+
+static void hippo_extjson_append_utf8(std::string &out, uint32_t cp)
+{
+	if (cp < 0x80) {
+		out.push_back((char) cp);
+	} else if (cp < 0x800) {
+		out.push_back((char) (0xc0 | (cp >> 6)));
+		out.push_back((char) (0x80 | (cp & 0x3f)));
+	} else if (cp < 0x10000) {
+		out.push_back((char) (0xe0 | (cp >> 12)));
+		out.push_back((char) (0x80 | ((cp >> 6) & 0x3f)));
+		out.push_back((char) (0x80 | (cp & 0x3f)));
+	} else {
+		out.push_back((char) (0xf0 | (cp >> 18)));
+		out.push_back((char) (0x80 | ((cp >> 12) & 0x3f)));
+		out.push_back((char) (0x80 | ((cp >> 6) & 0x3f)));
+		out.push_back((char) (0x80 | (cp & 0x3f)));
+	}
+}
+
+/* Parses the string at the parser's position. Without escapes, the result
+ * points into the JSON itself; otherwise it is unescaped into 'scratch'. */
+static void hippo_extjson_parse_string(hippo_extjson_parser_t *parser, std::string &scratch, const char **out, size_t *out_len, bool allow_nul)
+{
+	const char *p;
+	const char *run;
+
+	hippo_extjson_expect(parser, '"');
+
+	p = parser->p;
+	run = hippo_extjson_scan_plain(p, parser->end);
+
+	if (run < parser->end && *run == '"') {
+		*out = p;
+		*out_len = run - p;
+		parser->p = run + 1;
+	} else {
+		scratch.assign(p, run - p);
+		p = run;
+
+		for (;;) {
+			if (p >= parser->end) {
+				parser->p = p;
+				hippo_extjson_parse_error(parser, "Unterminated string");
+			}
+			if (*p == '"') {
+				break;
+			}
+			if (*p != '\\') {
+				parser->p = p;
+				hippo_extjson_parse_error(parser, "Unescaped control character in string");
+			}
+
+			p++;
+			if (p >= parser->end) {
+				continue;
+			}
+
+			switch (*p) {
+				case '"':  scratch.push_back('"'); break;
+				case '\\': scratch.push_back('\\'); break;
+				case '/':  scratch.push_back('/'); break;
+				case 'b':  scratch.push_back('\b'); break;
+				case 'f':  scratch.push_back('\f'); break;
+				case 'n':  scratch.push_back('\n'); break;
+				case 'r':  scratch.push_back('\r'); break;
+				case 't':  scratch.push_back('\t'); break;
+				case 'u': {
+					uint32_t cp;
+
+					parser->p = p - 1;
+					cp = hippo_extjson_parse_hex4(parser, p + 1);
+					p += 4;
+
+					if (cp >= 0xdc00 && cp <= 0xdfff) {
+						hippo_extjson_parse_error(parser, "Invalid \\u escape");
+					}
+					if (cp >= 0xd800 && cp <= 0xdbff) {
+						uint32_t low;
+
+						if (parser->end - p < 3 || p[1] != '\\' || p[2] != 'u') {
+							hippo_extjson_parse_error(parser, "Invalid \\u escape");
+						}
+						low = hippo_extjson_parse_hex4(parser, p + 3);
+						if (low < 0xdc00 || low > 0xdfff) {
+							hippo_extjson_parse_error(parser, "Invalid \\u escape");
+						}
+						cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+						p += 6;
+					}
+
+					hippo_extjson_append_utf8(scratch, cp);
+					break;
+				}
+				default:
+					parser->p = p - 1;
+					hippo_extjson_parse_error(parser, "Invalid escape");
+			}
+			p++;
+
+			run = hippo_extjson_scan_plain(p, parser->end);
+			scratch.append(p, run - p);
+			p = run;
+		}
+
+		*out = scratch.data();
+		*out_len = scratch.size();
+		parser->p = p + 1;
+	}
+
+	if (!bson_utf8_validate(*out, *out_len, allow_nul)) {
+		hippo_extjson_parse_error(parser, allow_nul ? "Invalid UTF-8 in string" : "Invalid UTF-8 or NUL in key");
+	}
+}
+
+/* For values that libbson wants as a C string, which can't have a NUL */
+static void hippo_extjson_parse_cstring(hippo_extjson_parser_t *parser, std::string &out)
+{
+	const char *str;
+	size_t len;
+
+	hippo_extjson_parse_string(parser, parser->value, &str, &len, false);
+	out.assign(str, len);
+}
+/* }}} */
+
+/* {{{ Numbers */
+/* Checks the grammar of the number at the parser's position, and returns its
+ * length and whether it has a fraction or exponent */
+static size_t hippo_extjson_scan_number(hippo_extjson_parser_t *parser, bool *is_double)
+{
+	const char *p = parser->p;
+	const char *end = parser->end;
+
+	*is_double = false;
+
+	if (p < end && *p == '-') {
+		p++;
+	}
+	if (p >= end || !isdigit((unsigned char) *p)) {
+		hippo_extjson_parse_error(parser, "Invalid number");
+	}
+	if (*p == '0') {
+		p++;
+	} else {
+		while (p < end && isdigit((unsigned char) *p)) {
+			p++;
+		}
+	}
+	if (p < end && *p == '.') {
+		*is_double = true;
+		p++;
+		if (p >= end || !isdigit((unsigned char) *p)) {
+			hippo_extjson_parse_error(parser, "Invalid number");
+		}
+		while (p < end && isdigit((unsigned char) *p)) {
+			p++;
+		}
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		*is_double = true;
+		p++;
+		if (p < end && (*p == '+' || *p == '-')) {
+			p++;
+		}
+		if (p >= end || !isdigit((unsigned char) *p)) {
+			hippo_extjson_parse_error(parser, "Invalid number");
+		}
+		while (p < end && isdigit((unsigned char) *p)) {
+			p++;
+		}
+	}
+
+	return p - parser->p;
+}
+
+/* Returns false if the integer does not fit in an int64_t */
+static bool hippo_extjson_to_int64(const char *str, size_t len, int64_t *out)
+{
+	bool negative = false;
+	uint64_t v = 0;
+	size_t i = 0;
+
+	if (i < len && str[i] == '-') {
+		negative = true;
+		i++;
+	}
+	if (i == len) {
+		return false;
+	}
+
+	for (; i < len; i++) {
+		unsigned digit = str[i] - '0';
+
+		if (digit > 9 || v > (UINT64_MAX - digit) / 10) {
+			return false;
+		}
+		v = v * 10 + digit;
+	}
+
+	if (negative) {
+		if (v > (uint64_t) INT64_MAX + 1) {
+			return false;
+		}
+		*out = (int64_t) (0 - v);
+	} else {
+		if (v > (uint64_t) INT64_MAX) {
+			return false;
+		}
+		*out = (int64_t) v;
+	}
+
+	return true;
+}
+
+/* strtod() needs the number on its own */
+static bool hippo_extjson_to_double(const char *str, size_t len, double *out)
+{
+	char tmp[64];
+	std::string long_number;
+	const char *number = tmp;
+	char *number_end;
+
+	if (len < sizeof(tmp)) {
+		memcpy(tmp, str, len);
+		tmp[len] = '\0';
+	} else {
+		long_number.assign(str, len);
+		number = long_number.c_str();
+	}
+
+	*out = strtod(number, &number_end);
+
+	return len && number_end == number + len;
+}
+
+/* Integers become an int32 if they fit, an int64 if they fit in that, and a
+ * double otherwise, as they do with libbson's JSON reader */
+static void hippo_extjson_parse_number(hippo_extjson_parser_t *parser, bson_t *bson, const char *key, size_t key_len)
+{
+	bool is_double;
+	size_t len = hippo_extjson_scan_number(parser, &is_double);
+	int64_t v_int64;
+	double v_double;
+
+	if (!is_double && hippo_extjson_to_int64(parser->p, len, &v_int64)) {
+		if (v_int64 >= INT32_MIN && v_int64 <= INT32_MAX) {
+			bson_append_int32(bson, key, key_len, (int32_t) v_int64);
+		} else {
+			bson_append_int64(bson, key, key_len, v_int64);
+		}
+	} else {
+		hippo_extjson_to_double(parser->p, len, &v_double);
+		bson_append_double(bson, key, key_len, v_double);
+	}
+
+	parser->p += len;
+}
+
+static int64_t hippo_extjson_parse_int64(hippo_extjson_parser_t *parser, const char *what)
+{
+	bool is_double;
+	size_t len;
+	int64_t v;
+
+	parser->p = hippo_extjson_skip_ws(parser->p, parser->end);
+	len = hippo_extjson_scan_number(parser, &is_double);
+
+	if (is_double || !hippo_extjson_to_int64(parser->p, len, &v)) {
+		hippo_extjson_parse_error(parser, what);
+	}
+	parser->p += len;
+
+	return v;
+}
+
+/* The numbers in wrappers such as {"$numberLong": "42"} are strings */
+static int64_t hippo_extjson_parse_int64_string(hippo_extjson_parser_t *parser, const char *what)
+{
+	const char *str;
+	size_t len;
+	int64_t v;
+
+	hippo_extjson_parse_string(parser, parser->value, &str, &len, false);
+	if (!hippo_extjson_to_int64(str, len, &v)) {
+		hippo_extjson_parse_error(parser, what);
+	}
+
+	return v;
+}
+/* }}} */
+
+/* {{{ Type wrappers */
+static void hippo_extjson_parse_object_members(hippo_extjson_parser_t *parser, bson_t *bson);
+
+/* Skips over any JSON value, without checking much: the value is parsed for
+ * real afterwards. Returns NULL if the JSON ends first. */
+static const char *hippo_extjson_skip_value(const char *p, const char *end)
+{
+	int depth = 0;
+
+	do {
+		p = hippo_extjson_skip_ws(p, end);
+		if (p >= end) {
+			return NULL;
+		}
+
+		switch (*p) {
+			case '"':
+				p++;
+				for (;;) {
+					p = hippo_extjson_scan_plain(p, end);
+					if (p >= end) {
+						return NULL;
+					}
+					if (*p == '"') {
+						p++;
+						break;
+					}
+					p += (*p == '\\') ? 2 : 1;
+				}
+				break;
+
+			case '{':
+			case '[':
+				depth++;
+				p++;
+				continue;
+
+			case '}':
+			case ']':
+				depth--;
+				p++;
+				break;
+
+			case ',':
+			case ':':
+				p++;
+				continue;
+
+			default:
+				while (p < end && !strchr(",:]} \t\r\n", *p)) {
+					p++;
+				}
+		}
+	} while (depth > 0);
+
+	return p;
+}
+
+/* Looks ahead at the object at the parser's position, and returns the set of
+ * wrapper keys it has if that is one of the type wrappers, or 0 */
+static int hippo_extjson_wrapper_keys(hippo_extjson_parser_t *parser)
+{
+	const char *p = hippo_extjson_skip_ws(parser->p + 1, parser->end);
+	const char *end = parser->end;
+	char binary_value = 0;
+	int keys = 0;
+
+	if (end - p < 2 || p[0] != '"' || p[1] != '$') {
+		return 0;
+	}
+
+	for (;;) {
+		const char *key;
+		int bit;
+
+		/* Wrapper keys never need escaping */
+		p = hippo_extjson_skip_ws(p, end);
+		if (p >= end || *p != '"') {
+			return 0;
+		}
+		key = ++p;
+		p = hippo_extjson_scan_plain(p, end);
+		if (p >= end || *p != '"') {
+			return 0;
+		}
+
+		bit = hippo_extjson_key_bit(key, p - key);
+		if (!bit || (keys & bit)) {
+			return 0;
+		}
+		keys |= bit;
+
+		p = hippo_extjson_skip_ws(p + 1, end);
+		if (p >= end || *p != ':') {
+			return 0;
+		}
+		p = hippo_extjson_skip_ws(p + 1, end);
+		if (bit == HIPPO_EXTJSON_KEY_BINARY && p < end) {
+			binary_value = *p;
+		}
+
+		p = hippo_extjson_skip_value(p, end);
+		if (!p) {
+			return 0;
+		}
+		p = hippo_extjson_skip_ws(p, end);
+		if (p < end && *p == ',') {
+			p++;
+			continue;
+		}
+		if (p < end && *p == '}') {
+			break;
+		}
+		return 0;
+	}
+
+	switch (keys) {
+		case HIPPO_EXTJSON_KEY_BINARY:
+			/* v2: {"$binary": {"base64": ..., "subType": ...}} */
+			return binary_value == '{' ? keys : 0;
+
+		case HIPPO_EXTJSON_KEY_BINARY | HIPPO_EXTJSON_KEY_TYPE:
+			/* legacy: {"$binary": ..., "$type": ...} */
+			return binary_value == '"' ? keys : 0;
+
+		case HIPPO_EXTJSON_KEY_OID:
+		case HIPPO_EXTJSON_KEY_DATE:
+		case HIPPO_EXTJSON_KEY_NUMBER_LONG:
+		case HIPPO_EXTJSON_KEY_NUMBER_INT:
+		case HIPPO_EXTJSON_KEY_NUMBER_DOUBLE:
+		case HIPPO_EXTJSON_KEY_NUMBER_DECIMAL:
+		case HIPPO_EXTJSON_KEY_REGEX | HIPPO_EXTJSON_KEY_OPTIONS:
+		case HIPPO_EXTJSON_KEY_REGULAR_EXPRESSION:
+		case HIPPO_EXTJSON_KEY_TIMESTAMP:
+		case HIPPO_EXTJSON_KEY_MINKEY:
+		case HIPPO_EXTJSON_KEY_MAXKEY:
+		case HIPPO_EXTJSON_KEY_UNDEFINED:
+		case HIPPO_EXTJSON_KEY_CODE:
+		case HIPPO_EXTJSON_KEY_CODE | HIPPO_EXTJSON_KEY_SCOPE:
+		case HIPPO_EXTJSON_KEY_SYMBOL:
+		case HIPPO_EXTJSON_KEY_DBPOINTER:
+			return keys;
+	}
+
+	return 0;
+}
+
+/* Calls 'on_member' for each member of the object at the parser's position,
+ * with the parser at the member's value */
+template <typename F>
+static void hippo_extjson_parse_members(hippo_extjson_parser_t *parser, F on_member)
+{
+	hippo_extjson_expect(parser, '{');
+
+	if (hippo_extjson_accept(parser, '}')) {
+		return;
+	}
+
+	do {
+		const char *key;
+		size_t key_len;
+
+		hippo_extjson_parse_string(parser, parser->key, &key, &key_len, false);
+		hippo_extjson_expect(parser, ':');
+		on_member(key, key_len);
+	} while (hippo_extjson_accept(parser, ','));
+
+	hippo_extjson_expect(parser, '}');
+}
+
+static bool hippo_extjson_key_is(const char *key, size_t key_len, const char *name)
+{
+	return strlen(name) == key_len && memcmp(key, name, key_len) == 0;
+}
+
+static void hippo_extjson_decode_base64(hippo_extjson_parser_t *parser, const std::string &in, std::string &out)
+{
+	uint32_t acc = 0;
+	int bits = 0;
+	size_t i;
+
+	out.clear();
+	out.reserve(in.size() / 4 * 3);
+
+	for (i = 0; i < in.size() && in[i] != '='; i++) {
+		char c = in[i];
+		int v;
+
+		if (c >= 'A' && c <= 'Z') {
+			v = c - 'A';
+		} else if (c >= 'a' && c <= 'z') {
+			v = c - 'a' + 26;
+		} else if (c >= '0' && c <= '9') {
+			v = c - '0' + 52;
+		} else if (c == '+') {
+			v = 62;
+		} else if (c == '/') {
+			v = 63;
+		} else {
+			hippo_extjson_parse_error(parser, "Invalid base64 in $binary");
+		}
+
+		acc = (acc << 6) | v;
+		bits += 6;
+		if (bits >= 8) {
+			bits -= 8;
+			out.push_back((char) ((acc >> bits) & 0xff));
+		}
+	}
+
+	for (; i < in.size(); i++) {
+		if (in[i] != '=') {
+			hippo_extjson_parse_error(parser, "Invalid base64 in $binary");
+		}
+	}
+}
+
+/* Days since 1970-01-01 of a date in the proleptic Gregorian calendar */
+static int64_t hippo_extjson_days_from_civil(int64_t y, unsigned m, unsigned d)
+{
+	y -= m <= 2;
+
+	int64_t era = (y >= 0 ? y : y - 399) / 400;
+	unsigned yoe = (unsigned) (y - era * 400);
+	unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + (int64_t) doe - 719468;
+}
+
+/* Parses the ISO-8601 dates of relaxed Extended JSON, such as
+ * "2014-11-20T01:03:31.987Z" or "2014-11-20T02:03:31+01:00" */
+static bool hippo_extjson_parse_iso8601(const char *s, size_t len, int64_t *msec)
+{
+	const char *end = s + len;
+	int fields[6];
+	const char separators[] = "--T::";
+	int64_t millis = 0;
+	int64_t offset = 0;
+
+	for (int i = 0; i < 6; i++) {
+		int digits = i == 0 ? 4 : 2;
+
+		fields[i] = 0;
+		for (int j = 0; j < digits; j++, s++) {
+			if (s >= end || !isdigit((unsigned char) *s)) {
+				return false;
+			}
+			fields[i] = fields[i] * 10 + (*s - '0');
+		}
+		if (i < 5) {
+			if (s >= end || *s != separators[i]) {
+				return false;
+			}
+			s++;
+		}
+	}
+
+	if (fields[1] < 1 || fields[1] > 12 || fields[2] < 1 || fields[2] > 31 || fields[3] > 23 || fields[4] > 59 || fields[5] > 60) {
+		return false;
+	}
+
+	if (s < end && *s == '.') {
+		int scale = 100;
+
+		s++;
+		if (s >= end || !isdigit((unsigned char) *s)) {
+			return false;
+		}
+		for (; s < end && isdigit((unsigned char) *s); s++) {
+			millis += (*s - '0') * scale;
+			scale /= 10;
+		}
+	}
+
+	if (s < end && *s == 'Z') {
+		s++;
+	} else if (s < end && (*s == '+' || *s == '-')) {
+		int sign = *s == '-' ? -1 : 1;
+		int hh, mm;
+
+		s++;
+		if (end - s == 5 && s[2] == ':') {
+			hh = (s[0] - '0') * 10 + (s[1] - '0');
+			mm = (s[3] - '0') * 10 + (s[4] - '0');
+		} else if (end - s == 4) {
+			hh = (s[0] - '0') * 10 + (s[1] - '0');
+			mm = (s[2] - '0') * 10 + (s[3] - '0');
+		} else {
+			return false;
+		}
+		for (const char *c = s; c < end; c++) {
+			if (*c != ':' && !isdigit((unsigned char) *c)) {
+				return false;
+			}
+		}
+		offset = sign * (hh * 3600 + mm * 60);
+		s = end;
+	} else {
+		return false;
+	}
+
+	if (s != end) {
+		return false;
+	}
+
+	*msec = (hippo_extjson_days_from_civil(fields[0], fields[1], fields[2]) * 86400 + fields[3] * 3600 + fields[4] * 60 + fields[5] - offset) * 1000 + millis;
+
+	return true;
+}
+
+static void hippo_extjson_parse_wrapper(hippo_extjson_parser_t *parser, int keys, bson_t *bson, const char *key, size_t key_len)
+{
+	std::string str[2];  /* $binary/$type, $regex/$options, $code, ... */
+	int64_t number[2] = { 0, 0 };
+	double v_double = 0;
+	bson_decimal128_t decimal;
+	bson_oid_t oid;
+	bson_t scope;
+	bool have_scope = false;
+
+	/* 'key' may point into the parser's key buffer, which the wrapper's own
+	 * keys overwrite */
+	std::string element_key(key, key_len);
+
+	try {
+		hippo_extjson_parse_members(parser, [&](const char *member, size_t member_len) {
+			switch (hippo_extjson_key_bit(member, member_len)) {
+				case HIPPO_EXTJSON_KEY_OID:
+					hippo_extjson_parse_cstring(parser, str[0]);
+					if (str[0].size() != 24 || !bson_oid_is_valid(str[0].data(), 24)) {
+						hippo_extjson_parse_error(parser, "Invalid $oid");
+					}
+					bson_oid_init_from_string(&oid, str[0].c_str());
+					break;
+
+				case HIPPO_EXTJSON_KEY_BINARY:
+					if (hippo_extjson_peek(parser, '"')) {
+						hippo_extjson_parse_cstring(parser, str[0]);
+						break;
+					}
+					hippo_extjson_parse_members(parser, [&](const char *name, size_t name_len) {
+						if (hippo_extjson_key_is(name, name_len, "base64")) {
+							hippo_extjson_parse_cstring(parser, str[0]);
+						} else if (hippo_extjson_key_is(name, name_len, "subType")) {
+							hippo_extjson_parse_cstring(parser, str[1]);
+						} else {
+							hippo_extjson_parse_error(parser, "Invalid $binary");
+						}
+					});
+					break;
+
+				case HIPPO_EXTJSON_KEY_TYPE:
+					hippo_extjson_parse_cstring(parser, str[1]);
+					break;
+
+				case HIPPO_EXTJSON_KEY_DATE:
+					if (hippo_extjson_peek(parser, '"')) {
+						hippo_extjson_parse_cstring(parser, str[0]);
+						if (!hippo_extjson_parse_iso8601(str[0].data(), str[0].size(), &number[0])) {
+							hippo_extjson_parse_error(parser, "Invalid $date");
+						}
+					} else if (hippo_extjson_peek(parser, '{')) {
+						bool found = false;
+
+						hippo_extjson_parse_members(parser, [&](const char *name, size_t name_len) {
+							if (!hippo_extjson_key_is(name, name_len, "$numberLong")) {
+								hippo_extjson_parse_error(parser, "Invalid $date");
+							}
+							number[0] = hippo_extjson_parse_int64_string(parser, "Invalid $date");
+							found = true;
+						});
+						if (!found) {
+							hippo_extjson_parse_error(parser, "Invalid $date");
+						}
+					} else {
+						number[0] = hippo_extjson_parse_int64(parser, "Invalid $date");
+					}
+					break;
+
+				case HIPPO_EXTJSON_KEY_NUMBER_LONG:
+					number[0] = hippo_extjson_parse_int64_string(parser, "Invalid $numberLong");
+					break;
+
+				case HIPPO_EXTJSON_KEY_NUMBER_INT:
+					number[0] = hippo_extjson_parse_int64_string(parser, "Invalid $numberInt");
+					if (number[0] < INT32_MIN || number[0] > INT32_MAX) {
+						hippo_extjson_parse_error(parser, "Invalid $numberInt");
+					}
+					break;
+
+				case HIPPO_EXTJSON_KEY_NUMBER_DOUBLE:
+					hippo_extjson_parse_cstring(parser, str[0]);
+					if (str[0] == "Infinity") {
+						v_double = INFINITY;
+					} else if (str[0] == "-Infinity") {
+						v_double = -INFINITY;
+					} else if (str[0] == "NaN") {
+						v_double = NAN;
+					} else if (!hippo_extjson_to_double(str[0].data(), str[0].size(), &v_double)) {
+						hippo_extjson_parse_error(parser, "Invalid $numberDouble");
+					}
+					break;
+
+				case HIPPO_EXTJSON_KEY_NUMBER_DECIMAL:
+					hippo_extjson_parse_cstring(parser, str[0]);
+					if (!bson_decimal128_from_string(str[0].c_str(), &decimal)) {
+						hippo_extjson_parse_error(parser, "Invalid $numberDecimal");
+					}
+					break;
+
+				case HIPPO_EXTJSON_KEY_REGEX:
+				case HIPPO_EXTJSON_KEY_CODE:
+				case HIPPO_EXTJSON_KEY_SYMBOL:
+					hippo_extjson_parse_cstring(parser, str[0]);
+					break;
+
+				case HIPPO_EXTJSON_KEY_OPTIONS:
+					hippo_extjson_parse_cstring(parser, str[1]);
+					break;
+
+				case HIPPO_EXTJSON_KEY_REGULAR_EXPRESSION:
+					hippo_extjson_parse_members(parser, [&](const char *name, size_t name_len) {
+						if (hippo_extjson_key_is(name, name_len, "pattern")) {
+							hippo_extjson_parse_cstring(parser, str[0]);
+						} else if (hippo_extjson_key_is(name, name_len, "options")) {
+							hippo_extjson_parse_cstring(parser, str[1]);
+						} else {
+							hippo_extjson_parse_error(parser, "Invalid $regularExpression");
+						}
+					});
+					break;
+
+				case HIPPO_EXTJSON_KEY_TIMESTAMP:
+					hippo_extjson_parse_members(parser, [&](const char *name, size_t name_len) {
+						int index = hippo_extjson_key_is(name, name_len, "t") ? 0 : (hippo_extjson_key_is(name, name_len, "i") ? 1 : -1);
+
+						if (index < 0) {
+							hippo_extjson_parse_error(parser, "Invalid $timestamp");
+						}
+						number[index] = hippo_extjson_parse_int64(parser, "Invalid $timestamp");
+						if (number[index] < 0 || number[index] > UINT32_MAX) {
+							hippo_extjson_parse_error(parser, "Invalid $timestamp");
+						}
+					});
+					break;
+
+				case HIPPO_EXTJSON_KEY_MINKEY:
+				case HIPPO_EXTJSON_KEY_MAXKEY:
+					if (hippo_extjson_parse_int64(parser, "Invalid $minKey or $maxKey") != 1) {
+						hippo_extjson_parse_error(parser, "Invalid $minKey or $maxKey");
+					}
+					break;
+
+				case HIPPO_EXTJSON_KEY_UNDEFINED:
+					parser->p = hippo_extjson_skip_ws(parser->p, parser->end);
+					if (parser->end - parser->p < 4 || memcmp(parser->p, "true", 4) != 0) {
+						hippo_extjson_parse_error(parser, "Invalid $undefined");
+					}
+					parser->p += 4;
+					break;
+
+				case HIPPO_EXTJSON_KEY_SCOPE:
+					if (!hippo_extjson_peek(parser, '{')) {
+						hippo_extjson_parse_error(parser, "Invalid $scope");
+					}
+					bson_init(&scope);
+					have_scope = true;
+					hippo_extjson_parse_object_members(parser, &scope);
+					break;
+
+				case HIPPO_EXTJSON_KEY_DBPOINTER:
+					hippo_extjson_parse_members(parser, [&](const char *name, size_t name_len) {
+						if (hippo_extjson_key_is(name, name_len, "$ref")) {
+							hippo_extjson_parse_cstring(parser, str[0]);
+						} else if (hippo_extjson_key_is(name, name_len, "$id")) {
+							hippo_extjson_parse_members(parser, [&](const char *id_name, size_t id_name_len) {
+								if (!hippo_extjson_key_is(id_name, id_name_len, "$oid")) {
+									hippo_extjson_parse_error(parser, "Invalid $dbPointer");
+								}
+								hippo_extjson_parse_cstring(parser, str[1]);
+							});
+						} else {
+							hippo_extjson_parse_error(parser, "Invalid $dbPointer");
+						}
+					});
+					if (str[1].size() != 24 || !bson_oid_is_valid(str[1].data(), 24)) {
+						hippo_extjson_parse_error(parser, "Invalid $dbPointer");
+					}
+					bson_oid_init_from_string(&oid, str[1].c_str());
+					break;
+			}
+		});
+	} catch (...) {
+		if (have_scope) {
+			bson_destroy(&scope);
+		}
+		throw;
+	}
+
+	key = element_key.data();
+
+	switch (keys) {
+		case HIPPO_EXTJSON_KEY_OID:
+			bson_append_oid(bson, key, key_len, &oid);
+			break;
+
+		case HIPPO_EXTJSON_KEY_BINARY:
+		case HIPPO_EXTJSON_KEY_BINARY | HIPPO_EXTJSON_KEY_TYPE: {
+			std::string data;
+			int subtype_hi, subtype_lo;
+
+			if (str[1].size() == 1) {
+				str[1].insert(0, 1, '0');
+			}
+			subtype_hi = str[1].size() == 2 ? hippo_extjson_hex_value(str[1][0]) : -1;
+			subtype_lo = str[1].size() == 2 ? hippo_extjson_hex_value(str[1][1]) : -1;
+			if (subtype_hi < 0 || subtype_lo < 0) {
+				hippo_extjson_parse_error(parser, "Invalid $binary subtype");
+			}
+
+			hippo_extjson_decode_base64(parser, str[0], data);
+			bson_append_binary(bson, key, key_len, (bson_subtype_t) (subtype_hi << 4 | subtype_lo), (const uint8_t*) data.data(), data.size());
+			break;
+		}
+
+		case HIPPO_EXTJSON_KEY_DATE:
+			bson_append_date_time(bson, key, key_len, number[0]);
+			break;
+
+		case HIPPO_EXTJSON_KEY_NUMBER_LONG:
+			bson_append_int64(bson, key, key_len, number[0]);
+			break;
+
+		case HIPPO_EXTJSON_KEY_NUMBER_INT:
+			bson_append_int32(bson, key, key_len, (int32_t) number[0]);
+			break;
+
+		case HIPPO_EXTJSON_KEY_NUMBER_DOUBLE:
+			bson_append_double(bson, key, key_len, v_double);
+			break;
+
+		case HIPPO_EXTJSON_KEY_NUMBER_DECIMAL:
+			bson_append_decimal128(bson, key, key_len, &decimal);
+			break;
+
+		case HIPPO_EXTJSON_KEY_REGEX | HIPPO_EXTJSON_KEY_OPTIONS:
+		case HIPPO_EXTJSON_KEY_REGULAR_EXPRESSION:
+			bson_append_regex(bson, key, key_len, str[0].c_str(), str[1].c_str());
+			break;
+
+		case HIPPO_EXTJSON_KEY_TIMESTAMP:
+			bson_append_timestamp(bson, key, key_len, (uint32_t) number[0], (uint32_t) number[1]);
+			break;
+
+		case HIPPO_EXTJSON_KEY_MINKEY:
+			bson_append_minkey(bson, key, key_len);
+			break;
+
+		case HIPPO_EXTJSON_KEY_MAXKEY:
+			bson_append_maxkey(bson, key, key_len);
+			break;
+
+		case HIPPO_EXTJSON_KEY_UNDEFINED:
+			bson_append_undefined(bson, key, key_len);
+			break;
+
+		case HIPPO_EXTJSON_KEY_CODE:
+			bson_append_code(bson, key, key_len, str[0].c_str());
+			break;
+
+		case HIPPO_EXTJSON_KEY_CODE | HIPPO_EXTJSON_KEY_SCOPE:
+			bson_append_code_with_scope(bson, key, key_len, str[0].c_str(), &scope);
+			bson_destroy(&scope);
+			break;
+
+		case HIPPO_EXTJSON_KEY_SYMBOL:
+			bson_append_symbol(bson, key, key_len, str[0].data(), str[0].size());
+			break;
+
+		case HIPPO_EXTJSON_KEY_DBPOINTER:
+			bson_append_dbpointer(bson, key, key_len, str[0].c_str(), &oid);
+			break;
+	}
+}
+/* }}} */
+
+/* {{{ Documents and arrays */
+static void hippo_extjson_parse_value(hippo_extjson_parser_t *parser, bson_t *bson, const char *key, size_t key_len);
+
+static void hippo_extjson_enter(hippo_extjson_parser_t *parser)
+{
+	if (++parser->depth > HIPPO_EXTJSON_MAX_DEPTH) {
+		hippo_extjson_parse_error(parser, "Nesting too deep");
+	}
+}
+
+static void hippo_extjson_parse_object_members(hippo_extjson_parser_t *parser, bson_t *bson)
+{
+	hippo_extjson_enter(parser);
+	hippo_extjson_expect(parser, '{');
+
+	if (!hippo_extjson_accept(parser, '}')) {
+		do {
+			const char *key;
+			size_t key_len;
+
+			hippo_extjson_parse_string(parser, parser->key, &key, &key_len, false);
+			hippo_extjson_expect(parser, ':');
+			hippo_extjson_parse_value(parser, bson, key, key_len);
+		} while (hippo_extjson_accept(parser, ','));
+
+		hippo_extjson_expect(parser, '}');
+	}
+
+	parser->depth--;
+}
+
+static void hippo_extjson_parse_array_members(hippo_extjson_parser_t *parser, bson_t *bson)
+{
+	uint32_t index = 0;
+
+	hippo_extjson_enter(parser);
+	hippo_extjson_expect(parser, '[');
+
+	if (!hippo_extjson_accept(parser, ']')) {
+		do {
+			const char *key;
+			char buf[16];
+			size_t key_len;
+
+			key_len = bson_uint32_to_string(index++, &key, buf, sizeof(buf));
+			hippo_extjson_parse_value(parser, bson, key, key_len);
+		} while (hippo_extjson_accept(parser, ','));
+
+		hippo_extjson_expect(parser, ']');
+	}
+
+	parser->depth--;
+}
+
+static bool hippo_extjson_parse_literal(hippo_extjson_parser_t *parser, const char *literal, size_t len)
+{
+	if ((size_t) (parser->end - parser->p) < len || memcmp(parser->p, literal, len) != 0) {
+		return false;
+	}
+	parser->p += len;
+
+	return true;
+}
+
+static void hippo_extjson_parse_value(hippo_extjson_parser_t *parser, bson_t *bson, const char *key, size_t key_len)
+{
+	parser->p = hippo_extjson_skip_ws(parser->p, parser->end);
+
+	if (parser->p >= parser->end) {
+		hippo_extjson_parse_error(parser, "Unexpected end of JSON");
+	}
+
+	switch (*parser->p) {
+		case '{': {
+			int keys = hippo_extjson_wrapper_keys(parser);
+			bson_t child;
+
+			if (keys) {
+				hippo_extjson_parse_wrapper(parser, keys, bson, key, key_len);
+				break;
+			}
+
+			bson_append_document_begin(bson, key, key_len, &child);
+			hippo_extjson_parse_object_members(parser, &child);
+			bson_append_document_end(bson, &child);
+			break;
+		}
+
+		case '[': {
+			bson_t child;
+
+			bson_append_array_begin(bson, key, key_len, &child);
+			hippo_extjson_parse_array_members(parser, &child);
+			bson_append_array_end(bson, &child);
+			break;
+		}
+
+		case '"': {
+			const char *str;
+			size_t len;
+
+			hippo_extjson_parse_string(parser, parser->value, &str, &len, true);
+			bson_append_utf8(bson, key, key_len, str, len);
+			break;
+		}
+
+		case 't':
+			if (!hippo_extjson_parse_literal(parser, "true", 4)) {
+				hippo_extjson_parse_error(parser, "Unexpected character");
+			}
+			bson_append_bool(bson, key, key_len, true);
+			break;
+
+		case 'f':
+			if (!hippo_extjson_parse_literal(parser, "false", 5)) {
+				hippo_extjson_parse_error(parser, "Unexpected character");
+			}
+			bson_append_bool(bson, key, key_len, false);
+			break;
+
+		case 'n':
+			if (!hippo_extjson_parse_literal(parser, "null", 4)) {
+				hippo_extjson_parse_error(parser, "Unexpected character");
+			}
+			bson_append_null(bson, key, key_len);
+			break;
+
+		default:
+			if (*parser->p != '-' && !isdigit((unsigned char) *parser->p)) {
+				hippo_extjson_parse_error(parser, "Unexpected character");
+			}
+			hippo_extjson_parse_number(parser, bson, key, key_len);
+	}
+}
+/* }}} */
+
+void hippo_bson_from_extended_json(const String &data, bson_t *bson)
+{
+	hippo_extjson_parser_t parser;
+
+	parser.start = data.data();
+	parser.p = hippo_extjson_skip_ws(data.data(), data.data() + data.size());
+	parser.end = data.data() + data.size();
+	parser.depth = 0;
+
+	if (parser.p == parser.end) {
+		throw MongoDriver::Utils::throwUnexpectedValueException("Empty JSON string");
+	}
+
+	/* Like libbson's JSON reader, only the first document is read */
+	if (*parser.p != '{') {
+		hippo_extjson_parse_error(&parser, "Expected a JSON object");
+	}
+	hippo_extjson_parse_object_members(&parser, bson);
+}
+/* }}} */
+
+}
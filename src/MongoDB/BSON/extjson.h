@@ -0,0 +1,37 @@
+/**
+ *  Copyright 2014-2015 MongoDB, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+#ifndef __MONGODB_BSON_EXTJSON_H__
+#define __MONGODB_BSON_EXTJSON_H__
+
+extern "C" {
+#include "../../../libbson/src/bson/bson.h"
+}
+
+namespace HPHP {
+
+/* This is not a bitfield */
+#define HIPPO_EXTJSON_CANONICAL 0x01
+#define HIPPO_EXTJSON_RELAXED   0x02
+
+/* Writes a single BSON document as MongoDB Extended JSON (v2) */
+String hippo_bson_to_extended_json(const String &data, int mode);
+
+/* Parses (Extended) JSON, v2 or legacy, into 'bson'. Throws an
+ * UnexpectedValueException on malformed input. */
+void hippo_bson_from_extended_json(const String &data, bson_t *bson);
+
+}
+#endif
@@ -15,9 +15,13 @@
  */
 
 #include "hphp/runtime/ext/extension.h"
+#include "hphp/runtime/base/array-iterator.h"
+#include "hphp/runtime/base/type-string.h"
 #include "hphp/runtime/vm/native-data.h"
 
 #include "functions.h"
+#include "DocumentReader.h"
+#include "extjson.h"
 
 #include "../../../bson.h"
 #include "../../../utils.h"
@@ -28,43 +32,158 @@ extern "C" {
 
 namespace HPHP {
 
+/* {{{ Encoding directly into a String */
+#define HIPPO_BSON_ESTIMATED_ELEMENT_SIZE 16
+#define HIPPO_BSON_MIN_ESTIMATED_SIZE     64
+
+typedef struct {
+	String  str;
+	size_t  len; /* bytes of str's buffer that libbson knows about */
+} hippo_bson_string_buffer_t;
+
+/* Realloc hook for bson_new_from_buffer() and bson_writer_new(). libbson
+ * updates 'len' itself once we return, but bson_writer_begin() already grows
+ * 'len' before calling us, so it can't be trusted to be within the String's
+ * buffer: only keep what actually fits in there. */
+static void *hippo_bson_string_realloc(void *mem, size_t num_bytes, void *ctx)
+{
+	hippo_bson_string_buffer_t *buffer = (hippo_bson_string_buffer_t*) ctx;
+	size_t in_use = buffer->len;
+
+	if (in_use > buffer->str.bufferSlice().size()) {
+		in_use = buffer->str.bufferSlice().size();
+	}
+
+	buffer->str.setSize(in_use);
+	buffer->str.reserve(num_bytes);
+
+	return buffer->str.bufferSlice().data();
+}
+
+static size_t hippo_bson_estimate_size(const Variant &data)
+{
+	size_t estimate = 5;
+
+	if (data.isArray()) {
+		estimate += data.getArrayData()->size() * HIPPO_BSON_ESTIMATED_ELEMENT_SIZE;
+	}
+
+	return estimate < HIPPO_BSON_MIN_ESTIMATED_SIZE ? HIPPO_BSON_MIN_ESTIMATED_SIZE : estimate;
+}
+/* }}} */
+
 String HHVM_FUNCTION(MongoDBBsonFromPHP, const Variant &data)
 {
+	hippo_bson_string_buffer_t buffer;
+	uint8_t *data_s;
 	bson_t *bson;
-	String s;
-	unsigned char *data_s;
+
+	buffer.str = String(hippo_bson_estimate_size(data), ReserveString);
+	buffer.len = buffer.str.bufferSlice().size();
+
+	/* Start out with an empty document, which bson_new_from_buffer() then
+	 * grows in place through hippo_bson_string_realloc() */
+	data_s = (uint8_t*) buffer.str.bufferSlice().data();
+	memcpy(data_s, "\x05\x00\x00\x00\x00", 5);
+
+	bson = bson_new_from_buffer(&data_s, &buffer.len, hippo_bson_string_realloc, &buffer);
 
 	VariantToBsonConverter converter(data, HIPPO_BSON_NO_FLAGS);
-	bson = bson_new();
-	converter.convert(bson);
+	try {
+		converter.convert(bson);
+	} catch (...) {
+		bson_destroy(bson);
+		throw;
+	}
 
-	s = String(bson->len, ReserveString);
-	data_s = (unsigned char*) s.bufferSlice().data();
-	memcpy(data_s, bson_get_data(bson), bson->len);
-	s.setSize(bson->len);
+	buffer.str.setSize(bson->len);
+	bson_destroy(bson);
 
-	return s;
+	return buffer.str;
 }
 
+/* Encodes all documents one after the other into a single String, with a
+ * bson_writer_t that grows the String through the same realloc hook as
+ * fromPHP(). The start offset of each document is collected into 'offsets'
+ * if it was passed in. */
+String HHVM_FUNCTION(MongoDBBsonFromPHPMany, const Array &documents, VRefParam offsets)
+{
+	hippo_bson_string_buffer_t buffer;
+	bson_writer_t *writer;
+	Array offsets_arr = Array::Create();
+	uint8_t *data_s;
+	bson_t *bson;
+	size_t estimate;
+	int64_t index = 0;
+
+	estimate = documents.size() * HIPPO_BSON_MIN_ESTIMATED_SIZE;
+	buffer.str = String(estimate < HIPPO_BSON_MIN_ESTIMATED_SIZE ? HIPPO_BSON_MIN_ESTIMATED_SIZE : estimate, ReserveString);
+	buffer.len = buffer.str.bufferSlice().size();
+	data_s = (uint8_t*) buffer.str.bufferSlice().data();
+
+	writer = bson_writer_new(&data_s, &buffer.len, 0, hippo_bson_string_realloc, &buffer);
+
+	for (ArrayIter iter(documents); iter; ++iter, index++) {
+		const Variant &document = iter.secondRef();
+
+		if (!document.isArray() && !document.isObject()) {
+			bson_writer_destroy(writer);
+			throw MongoDriver::Utils::throwInvalidArgumentException("Expected document " + String(index) + " to be an array or object, " + getDataTypeString(document.getType()).c_str() + " given");
+		}
+
+		offsets_arr.append((int64_t) bson_writer_get_length(writer));
+
+		bson_writer_begin(writer, &bson);
+
+		VariantToBsonConverter converter(document, HIPPO_BSON_NO_FLAGS);
+		try {
+			converter.convert(bson);
+		} catch (...) {
+			bson_writer_rollback(writer);
+			bson_writer_destroy(writer);
+			throw;
+		}
+
+		bson_writer_end(writer);
+	}
+
+	buffer.str.setSize(bson_writer_get_length(writer));
+	bson_writer_destroy(writer);
+
+	offsets.assignIfRef(offsets_arr);
+
+	return buffer.str;
+}
+
+/* The parser writes straight into the returned String, instead of into a
+ * bson_t that then has to be copied. BSON is nearly always smaller than the
+ * JSON it came from, so the length of the JSON makes for a good initial
+ * size. */
 Variant HHVM_FUNCTION(MongoDBBsonFromJson, const String &data)
 {
-	bson_t bson = BSON_INITIALIZER;
-	bson_error_t error;
+	hippo_bson_string_buffer_t buffer;
+	uint8_t *data_s;
+	bson_t *bson;
 
-	if (bson_init_from_json(&bson, (const char *)data.c_str(), data.length(), &error)) {
-		String s;
-		unsigned char *data_s;
+	buffer.str = String(data.size() < HIPPO_BSON_MIN_ESTIMATED_SIZE ? HIPPO_BSON_MIN_ESTIMATED_SIZE : data.size(), ReserveString);
+	buffer.len = buffer.str.bufferSlice().size();
 
-		s = String(bson.len, ReserveString);
-		data_s = (unsigned char*) s.bufferSlice().data();
-		memcpy(data_s, bson_get_data(&bson), bson.len);
-		s.setSize(bson.len);
+	data_s = (uint8_t*) buffer.str.bufferSlice().data();
+	memcpy(data_s, "\x05\x00\x00\x00\x00", 5);
 
-		return s;
-	} else {
-		throw MongoDriver::Utils::throwUnexpectedValueException(error.message ? error.message : "Error parsing JSON");
-		return Variant();
+	bson = bson_new_from_buffer(&data_s, &buffer.len, hippo_bson_string_realloc, &buffer);
+
+	try {
+		hippo_bson_from_extended_json(data, bson);
+	} catch (...) {
+		bson_destroy(bson);
+		throw;
 	}
+
+	buffer.str.setSize(bson->len);
+	bson_destroy(bson);
+
+	return buffer.str;
 }
 
 Variant HHVM_FUNCTION(MongoDBBsonToPHP, const String &data, const Variant &typemap)
@@ -82,6 +201,35 @@ Variant HHVM_FUNCTION(MongoDBBsonToPHP, const String &data, const Variant &typem
 	}
 }
 
+String HHVM_FUNCTION(MongoDBBsonToCanonicalExtendedJson, const String &data)
+{
+	return hippo_bson_to_extended_json(data, HIPPO_EXTJSON_CANONICAL);
+}
+
+String HHVM_FUNCTION(MongoDBBsonToRelaxedExtendedJson, const String &data)
+{
+	return hippo_bson_to_extended_json(data, HIPPO_EXTJSON_RELAXED);
+}
+
+Object HHVM_FUNCTION(MongoDBBsonReadDocuments, const Variant &source, const Variant &typemap)
+{
+	hippo_bson_conversion_options_t options = HIPPO_TYPEMAP_INITIALIZER;
+
+	parseTypeMap(&options, typemap.toArray());
+
+	return createMongoBsonDocumentReaderObject(source, options);
+}
+
+/* Debug builds only; NULL otherwise */
+Variant HHVM_FUNCTION(MongoDBBsonKeyAllocations)
+{
+#ifndef NDEBUG
+	return Variant((int64_t) hippo_bson_key_allocations());
+#else
+	return Variant();
+#endif
+}
+
 Variant HHVM_FUNCTION(MongoDBBsonToJson, const String &data)
 {
 	const bson_t  *b;
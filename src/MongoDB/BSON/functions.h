@@ -18,9 +18,14 @@
 namespace HPHP {
 
 String HHVM_FUNCTION(MongoDBBsonFromPHP, const Variant &data);
+String HHVM_FUNCTION(MongoDBBsonFromPHPMany, const Array &documents, VRefParam offsets);
 Variant HHVM_FUNCTION(MongoDBBsonFromJson, const String &data);
 Variant HHVM_FUNCTION(MongoDBBsonToPHP, const String &data, const Variant &typemap);
 Variant HHVM_FUNCTION(MongoDBBsonToJson, const String &data);
+String HHVM_FUNCTION(MongoDBBsonToCanonicalExtendedJson, const String &data);
+String HHVM_FUNCTION(MongoDBBsonToRelaxedExtendedJson, const String &data);
+Object HHVM_FUNCTION(MongoDBBsonReadDocuments, const Variant &source, const Variant &typemap);
+Variant HHVM_FUNCTION(MongoDBBsonKeyAllocations);
 }
 #endif
 
@@ -15,9 +15,11 @@
  */
 
 #include "hphp/runtime/ext/extension.h"
+#include "hphp/runtime/base/packed-array.h"
 #include "hphp/runtime/vm/native-data.h"
 
 #include "../../../bson.h"
+#include "../../../pool.h"
 #include "../../../utils.h"
 #include "../../../mongodb.h"
 
@@ -42,13 +44,35 @@ const StaticString s_MongoDBDriverCursor_server("server");
 IMPLEMENT_GET_CLASS(MongoDBDriverCursorData);
 
 static bool hippo_cursor_load_current(MongoDBDriverCursorData* data);
+static void hippo_cursor_stop_prefetch(hippo_cursor_prefetch_t *prefetch);
+
+void MongoDBDriverCursorData::sweep()
+{
+	if (prefetch) {
+		hippo_cursor_stop_prefetch(prefetch);
+		delete prefetch;
+		prefetch = NULL;
+	}
+	if (prefetch_current) {
+		bson_destroy(prefetch_current);
+		prefetch_current = NULL;
+	}
+
+	/* For an exhaust cursor that hasn't been read to the end, this also
+	 * drops the connection the server is still streaming batches over, as
+	 * that connection can't be used for anything else anymore. */
+	if (cursor) {
+		auto client_guard = Pool::LockClient(client);
+		mongoc_cursor_destroy(cursor);
+		cursor = NULL;
+	}
+}
 
 Object hippo_cursor_init(mongoc_cursor_t *cursor, mongoc_client_t *client, const Variant &readPreference)
 {
 	static HPHP::Class* c_result;
 
-	c_result = HPHP::Unit::lookupClass(HPHP::s_MongoDriverCursor_className.get());
-	assert(c_result);
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_result, s_MongoDriverCursor_className);
 	HPHP::Object obj = HPHP::Object{c_result};
 
 	HPHP::MongoDBDriverCursorData* cursor_data = HPHP::Native::data<HPHP::MongoDBDriverCursorData>(obj.get());
@@ -62,7 +86,9 @@ Object hippo_cursor_init(mongoc_cursor_t *cursor, mongoc_client_t *client, const
 	cursor_data->m_collection = NULL;
 	cursor_data->current = -1;
 
-	hippo_cursor_load_current(cursor_data);
+	if (hippo_cursor_load_current(cursor_data)) {
+		cursor_data->current = cursor_data->delivered++;
+	}
 
 	return obj;
 }
@@ -90,11 +116,167 @@ Object hippo_cursor_init_for_query(mongoc_cursor_t *cursor, mongoc_client_t *cli
 	return tmp;
 }
 
+/* Runs on its own thread, pulling documents through libmongoc (and with that
+ * issuing the getMores) while PHP is still working through what has already
+ * been buffered. It only touches the client while holding the client's lock,
+ * and only ever copies plain bson_t's, never request memory. */
+static void hippo_cursor_prefetch_worker(mongoc_cursor_t *cursor, hippo_cursor_prefetch_t *prefetch)
+{
+	const bson_t *doc;
+	bson_t *copy;
+	bool more;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> guard(prefetch->lock);
+
+			prefetch->cond.wait(guard, [prefetch] {
+				return prefetch->stopping || prefetch->buffered < prefetch->max_buffered;
+			});
+
+			if (prefetch->stopping) {
+				return;
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> client_guard(*prefetch->client_lock);
+
+			more = mongoc_cursor_next(cursor, &doc);
+			copy = more ? bson_copy(doc) : NULL;
+		}
+
+		std::lock_guard<std::mutex> guard(prefetch->lock);
+
+		if (!more) {
+			prefetch->finished = true;
+			prefetch->cond.notify_all();
+			return;
+		}
+
+		prefetch->buffer.push_back(copy);
+		prefetch->buffered += copy->len;
+		prefetch->cond.notify_all();
+	}
+}
+
+/* Hands out the next buffered document, waiting for the worker if it hasn't
+ * caught up yet. Returns NULL once the cursor is exhausted. The caller owns
+ * the returned document. */
+static bson_t *hippo_cursor_prefetch_pop(hippo_cursor_prefetch_t *prefetch)
+{
+	std::unique_lock<std::mutex> guard(prefetch->lock);
+	bson_t *doc;
+
+	prefetch->cond.wait(guard, [prefetch] {
+		return !prefetch->buffer.empty() || prefetch->finished;
+	});
+
+	if (prefetch->buffer.empty()) {
+		return NULL;
+	}
+
+	doc = prefetch->buffer.front();
+	prefetch->buffer.pop_front();
+	prefetch->buffered -= doc->len;
+	prefetch->cond.notify_all();
+
+	return doc;
+}
+
+static void hippo_cursor_stop_prefetch(hippo_cursor_prefetch_t *prefetch)
+{
+	{
+		std::lock_guard<std::mutex> guard(prefetch->lock);
+
+		prefetch->stopping = true;
+		prefetch->cond.notify_all();
+	}
+
+	/* A getMore in flight has to complete before the cursor can go */
+	if (prefetch->worker.joinable()) {
+		prefetch->worker.join();
+	}
+
+	for (auto doc : prefetch->buffer) {
+		bson_destroy(doc);
+	}
+	prefetch->buffer.clear();
+	prefetch->buffered = 0;
+}
+
+/* Switches a freshly created cursor over to prefetching. The worker is about
+ * to move libmongoc's cursor on, so the current document is rebound to our
+ * own copy of it before the worker starts. */
+void hippo_cursor_start_prefetch(const Object &obj, size_t max_bytes)
+{
+	MongoDBDriverCursorData* data = Native::data<MongoDBDriverCursorData>(obj.get());
+	const bson_t *doc;
+
+	doc = mongoc_cursor_current(data->cursor);
+	if (!doc) {
+		/* Nothing to prefetch */
+		return;
+	}
+	data->prefetch_current = bson_copy(doc);
+
+	data->prefetch = new hippo_cursor_prefetch_t;
+	data->prefetch->buffered = 0;
+	data->prefetch->max_buffered = max_bytes;
+	data->prefetch->finished = false;
+	data->prefetch->stopping = false;
+	data->prefetch->client_lock = Pool::ShareClient(data->client);
+
+	hippo_cursor_load_current(data);
+
+	data->prefetch->worker = std::thread(hippo_cursor_prefetch_worker, data->cursor, data->prefetch);
+}
+
+/* Moves the cursor on by one document, from the prefetch buffer when there
+ * is one */
+static bool hippo_cursor_advance(MongoDBDriverCursorData* data, const bson_t **doc)
+{
+	if (data->prefetch) {
+		if (data->prefetch_current) {
+			bson_destroy(data->prefetch_current);
+		}
+		data->prefetch_current = hippo_cursor_prefetch_pop(data->prefetch);
+		*doc = data->prefetch_current;
+
+		return data->prefetch_current != NULL;
+	}
+
+	auto client_guard = Pool::LockClient(data->client);
+	return mongoc_cursor_next(data->cursor, doc);
+}
+
 static void invalidate_current(MongoDBDriverCursorData *data)
 {
 	if (data->zchild_active) {
 		data->zchild_active = false;
 	}
+	data->zchild_raw = NULL;
+	data->zchild = Variant();
+}
+
+/* Documents are only decoded once something asks for them, so that a
+ * setTypeMap() straight after executeQuery() doesn't decode the first
+ * document twice */
+static const Variant& hippo_cursor_current(MongoDBDriverCursorData *data)
+{
+	if (data->zchild_raw) {
+		Variant v;
+
+		/* Only forget about the raw document once it has been decoded, so
+		 * that a decoding error is raised again rather than the previous
+		 * document being returned */
+		BsonToVariantConverter convertor(bson_get_data(data->zchild_raw), data->zchild_raw->len, data->bson_options);
+		convertor.convert(&v);
+		data->zchild = v;
+		data->zchild_raw = NULL;
+	}
+
+	return data->zchild;
 }
 
 Array HHVM_METHOD(MongoDBDriverCursor, __debugInfo)
@@ -131,11 +313,14 @@ Array HHVM_METHOD(MongoDBDriverCursor, __debugInfo)
 		retval.add(s_MongoDBDriverCursor_readPreference, Variant());
 	}
 
-	retval.add(s_MongoDBDriverCursor_isDead, !mongoc_cursor_is_alive(data->cursor));
+	{
+		auto client_guard = Pool::LockClient(data->client);
+		retval.add(s_MongoDBDriverCursor_isDead, !mongoc_cursor_is_alive(data->cursor));
+	}
 
 	if (data->zchild_active && data->current != -1) {
 		retval.add(s_MongoDBDriverCursor_currentIndex, data->current);
-		retval.add(s_MongoDBDriverCursor_currentDocument, data->zchild);
+		retval.add(s_MongoDBDriverCursor_currentDocument, hippo_cursor_current(data));
 	} else {
 		retval.add(s_MongoDBDriverCursor_currentIndex, 0);
 		retval.add(s_MongoDBDriverCursor_currentDocument, Variant());
@@ -152,12 +337,12 @@ Object HHVM_METHOD(MongoDBDriverCursor, getId)
 	static Class* c_cursor;
 	int64_t cursorid;
 	MongoDBDriverCursorData* data = Native::data<MongoDBDriverCursorData>(this_);
+	auto client_guard = Pool::LockClient(data->client);
 
 	cursorid = mongoc_cursor_get_id(data->cursor);
 
 	/* Prepare result */
-	c_cursor = Unit::lookupClass(s_MongoDriverCursorId_className.get());
-	assert(c_cursor);
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_cursor, s_MongoDriverCursorId_className);
 	Object obj = Object{c_cursor};
 
 	MongoDBDriverCursorIdData* cursorid_data = Native::data<MongoDBDriverCursorIdData>(obj.get());
@@ -171,7 +356,7 @@ Variant HHVM_METHOD(MongoDBDriverCursor, current)
 {
 	MongoDBDriverCursorData* data = Native::data<MongoDBDriverCursorData>(this_);
 
-	return data->zchild;
+	return hippo_cursor_current(data);
 }
 
 int64_t HHVM_METHOD(MongoDBDriverCursor, key)
@@ -187,14 +372,14 @@ bool hippo_cursor_load_current(MongoDBDriverCursorData* data)
 
 	invalidate_current(data);
 
-	doc = mongoc_cursor_current(data->cursor);
+	if (data->prefetch) {
+		doc = data->prefetch_current;
+	} else {
+		doc = mongoc_cursor_current(data->cursor);
+	}
 	if (doc) {
-		Variant v;
-
-		BsonToVariantConverter convertor(bson_get_data(doc), doc->len, data->bson_options);
-		convertor.convert(&v);
 		data->zchild_active = true;
-		data->zchild = v;
+		data->zchild_raw = doc;
 
 		return true;
 	}
@@ -205,7 +390,7 @@ static bool hippo_cursor_load_next(MongoDBDriverCursorData* data)
 {
 	const bson_t *doc;
 
-	if (mongoc_cursor_next(data->cursor, &doc)) {
+	if (hippo_cursor_advance(data, &doc)) {
 		return hippo_cursor_load_current(data);
 	}
 	return false;
@@ -217,8 +402,12 @@ static bool hippo_cursor_next(MongoDBDriverCursorData* data)
 
 	data->next_after_rewind++;
 
-	data->current++;
+	/* The key is the number of documents delivered before this one, so
+	 * that it doesn't depend on whether rewind() was called before a
+	 * tailable cursor's first document arrived, and so that tryNext()
+	 * carries on counting from the last document */
 	if (hippo_cursor_load_next(data)) {
+		data->current = data->delivered++;
 		return true;
 	} else {
 		invalidate_current(data);
@@ -227,11 +416,13 @@ static bool hippo_cursor_next(MongoDBDriverCursorData* data)
 	return false;
 }
 
-Variant HHVM_METHOD(MongoDBDriverCursor, next)
+/* Called for every element of a foreach, so this doesn't return anything:
+ * whether there is a next document is what valid() is for */
+void HHVM_METHOD(MongoDBDriverCursor, next)
 {
 	MongoDBDriverCursorData* data = Native::data<MongoDBDriverCursorData>(this_);
 
-	return hippo_cursor_next(data) ? String("next") : String("fail");
+	hippo_cursor_next(data);
 }
 
 static void hippo_cursor_rewind(MongoDBDriverCursorData* data)
@@ -244,7 +435,9 @@ static void hippo_cursor_rewind(MongoDBDriverCursorData* data)
 		}
 	}
 
-	data->current = 0;
+	if (!data->delivered) {
+		data->current = 0;
+	}
 }
 
 void HHVM_METHOD(MongoDBDriverCursor, rewind)
@@ -268,25 +461,78 @@ bool HHVM_METHOD(MongoDBDriverCursor, valid)
 bool HHVM_METHOD(MongoDBDriverCursor, isDead)
 {
 	MongoDBDriverCursorData* data = Native::data<MongoDBDriverCursorData>(this_);
+	auto client_guard = Pool::LockClient(data->client);
 
 	return !(mongoc_cursor_is_alive(data->cursor));
 }
 
+/* Don't reserve more than this up front, as a batch size is only a hint */
+#define HIPPO_CURSOR_TOARRAY_MAX_RESERVE 10000
+
+/* Drains the cursor by decoding every document straight into the packed
+ * result array, instead of going through hippo_cursor_next() and 'zchild'
+ * for each of them. The keys are the same 0..n-1 that iterating gives. */
 Array HHVM_METHOD(MongoDBDriverCursor, toArray)
 {
 	MongoDBDriverCursorData* data = Native::data<MongoDBDriverCursorData>(this_);
-	Array retval = Array::Create();
+	const bson_t *doc;
+	uint32_t reserve;
+	Array retval;
 
 	hippo_cursor_rewind(data);
 
-	while (data->zchild_active) {
-		retval.add(data->current, data->zchild);
-		hippo_cursor_next(data);
+	{
+		auto client_guard = Pool::LockClient(data->client);
+		reserve = mongoc_cursor_get_batch_size(data->cursor);
+	}
+	if (reserve > HIPPO_CURSOR_TOARRAY_MAX_RESERVE) {
+		reserve = HIPPO_CURSOR_TOARRAY_MAX_RESERVE;
+	}
+	retval = Array::attach(PackedArray::MakeReserve(reserve));
+
+	/* The first document was loaded when the cursor was created, and may
+	 * already have been decoded through current() */
+	if (data->zchild_active) {
+		retval.append(hippo_cursor_current(data));
+	}
+
+	while (hippo_cursor_advance(data, &doc)) {
+		Variant v;
+
+		BsonToVariantConverter convertor(bson_get_data(doc), doc->len, data->bson_options);
+		convertor.convert(&v);
+		retval.append(v);
 	}
 
+	/* Leave the cursor in the same state as iterating to the end would: the
+	 * key stays on the last document, as the final next() doesn't move it */
+	invalidate_current(data);
+	data->delivered = retval.size();
+	data->current = retval.size() ? retval.size() - 1 : 0;
+	data->next_after_rewind += retval.size();
+
 	return retval;
 }
 
+/* Unlike next(), this throws on errors, so that a tailable cursor that is
+ * merely waiting for new data can be told apart from one that has failed */
+bool HHVM_METHOD(MongoDBDriverCursor, tryNext)
+{
+	MongoDBDriverCursorData* data = Native::data<MongoDBDriverCursorData>(this_);
+	bson_error_t error;
+
+	if (hippo_cursor_next(data)) {
+		return true;
+	}
+
+	auto client_guard = Pool::LockClient(data->client);
+	if (mongoc_cursor_error(data->cursor, &error)) {
+		throw MongoDriver::Utils::throwExceptionFromBsonError(&error);
+	}
+
+	return false;
+}
+
 Object HHVM_METHOD(MongoDBDriverCursor, getServer)
 {
 	MongoDBDriverCursorData* data = Native::data<MongoDBDriverCursorData>(this_);
@@ -301,7 +547,7 @@ void HHVM_METHOD(MongoDBDriverCursor, setTypeMap, const Array &typemap)
 
 	parseTypeMap(&data->bson_options, typemap);
 
-	/* Reconvert the current document to use the new typemap */
+	/* Have the current document decoded again, with the new typemap */
 	hippo_cursor_load_current(data);
 }
 
@@ -16,6 +16,12 @@
 #ifndef __MONGODB_DRIVER_CURSOR_H__
 #define __MONGODB_DRIVER_CURSOR_H__
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 extern "C" {
 #include "../../../libmongoc/src/mongoc/mongoc.h"
 }
@@ -26,6 +32,21 @@ namespace HPHP {
 
 extern const StaticString s_MongoDriverCursor_className;
 
+/* State shared between a cursor and the thread that runs its getMores ahead
+ * of PHP. Documents are copied into 'buffer' until 'buffered' reaches
+ * 'max_buffered' bytes. */
+typedef struct {
+	std::thread             worker;
+	std::mutex              lock;
+	std::condition_variable cond;
+	std::deque<bson_t*>     buffer;
+	size_t                  buffered;
+	size_t                  max_buffered;
+	bool                    finished;
+	bool                    stopping;
+	std::shared_ptr<std::mutex> client_lock;
+} hippo_cursor_prefetch_t;
+
 class MongoDBDriverCursorData
 {
 	public:
@@ -43,16 +64,20 @@ class MongoDBDriverCursorData
 		Variant          m_command;
 		Object           m_query;
 		int64_t          current;
+		int64_t          delivered = 0; /* documents that have been the current one */
 		int              next_after_rewind = 0;
 
 		/* Conversion & Flags */
 		int zchild_active;
 		Variant zchild;
+		const bson_t *zchild_raw = NULL; /* current document, until it is decoded into zchild */
 		hippo_bson_conversion_options_t bson_options;
 
-		void sweep() {
-			mongoc_cursor_destroy(cursor);
-		}
+		/* Prefetching */
+		hippo_cursor_prefetch_t *prefetch = NULL;
+		bson_t *prefetch_current = NULL;
+
+		void sweep();
 
 		MongoDBDriverCursorData() {
 			bson_options = HIPPO_TYPEMAP_INITIALIZER;
@@ -71,15 +96,17 @@ void HHVM_METHOD(MongoDBDriverCursor, setTypeMap, const Array &typemap);
 
 Variant HHVM_METHOD(MongoDBDriverCursor, current);
 int64_t HHVM_METHOD(MongoDBDriverCursor, key);
-Variant HHVM_METHOD(MongoDBDriverCursor, next);
+void HHVM_METHOD(MongoDBDriverCursor, next);
 void HHVM_METHOD(MongoDBDriverCursor, rewind);
 bool HHVM_METHOD(MongoDBDriverCursor, valid);
 bool HHVM_METHOD(MongoDBDriverCursor, isDead);
 
 Array HHVM_METHOD(MongoDBDriverCursor, toArray);
+bool HHVM_METHOD(MongoDBDriverCursor, tryNext);
 
 Object hippo_cursor_init_for_command(mongoc_cursor_t *cursor, mongoc_client_t *client, const char *db, const Variant &command, const Variant &readPreference);
 Object hippo_cursor_init_for_query(mongoc_cursor_t *cursor, mongoc_client_t *client, const String &ns, const Object &query, const Variant &readPreference);
+void hippo_cursor_start_prefetch(const Object &cursor, size_t max_bytes);
 
 }
 #endif
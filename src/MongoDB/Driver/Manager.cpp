@@ -479,7 +479,10 @@ Array HHVM_METHOD(MongoDBDriverManager, __debugInfo)
 
 	retval.add(s_MongoDBDriverManager_uri, (char*) mongoc_uri_get_string(mongoc_client_get_uri(data->m_client)));
 
-	sds = mongoc_client_get_server_descriptions(data->m_client, &n);
+	{
+		auto client_guard = Pool::LockClient(data->m_client);
+		sds = mongoc_client_get_server_descriptions(data->m_client, &n);
+	}
 	for (i = 0; i < n; i++) {
 		if (sds[i]->type == MONGOC_SERVER_UNKNOWN) {
 			continue;
@@ -549,11 +552,12 @@ Object HHVM_METHOD(MongoDBDriverManager, getReadConcern)
 {
 	MongoDBDriverManagerData *data = Native::data<MongoDBDriverManagerData>(this_);
 
-	Class *c_rc = Unit::lookupClass(s_MongoDriverReadConcern_className.get());
-	assert(c_rc);
+	static Class *c_rc = nullptr;
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_rc, s_MongoDriverReadConcern_className);
 	Object rc_obj = Object{c_rc};
 	MongoDBDriverReadConcernData* rc_data = Native::data<HPHP::MongoDBDriverReadConcernData>(rc_obj.get());
 
+	auto client_guard = Pool::LockClient(data->m_client);
 	rc_data->m_read_concern = mongoc_read_concern_copy(mongoc_client_get_read_concern(data->m_client));
 
 	return rc_obj;
@@ -563,11 +567,12 @@ Object HHVM_METHOD(MongoDBDriverManager, getReadPreference)
 {
 	MongoDBDriverManagerData *data = Native::data<MongoDBDriverManagerData>(this_);
 
-	Class *c_rp = Unit::lookupClass(s_MongoDriverReadPreference_className.get());
-	assert(c_rp);
+	static Class *c_rp = nullptr;
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_rp, s_MongoDriverReadPreference_className);
 	Object rp_obj = Object{c_rp};
 	MongoDBDriverReadPreferenceData* rp_data = Native::data<HPHP::MongoDBDriverReadPreferenceData>(rp_obj.get());
 
+	auto client_guard = Pool::LockClient(data->m_client);
 	rp_data->m_read_preference = mongoc_read_prefs_copy(mongoc_client_get_read_prefs(data->m_client));
 
 	return rp_obj;
@@ -582,7 +587,10 @@ Array HHVM_METHOD(MongoDBDriverManager, getServers)
 
 	Array retval = Array::Create();
 
-	sds = mongoc_client_get_server_descriptions(data->m_client, &n);
+	{
+		auto client_guard = Pool::LockClient(data->m_client);
+		sds = mongoc_client_get_server_descriptions(data->m_client, &n);
+	}
 	for (i = 0; i < n; i++) {
 		if (sds[i]->type == MONGOC_SERVER_UNKNOWN) {
 			continue;
@@ -603,11 +611,12 @@ Object HHVM_METHOD(MongoDBDriverManager, getWriteConcern)
 {
 	MongoDBDriverManagerData* data = Native::data<MongoDBDriverManagerData>(this_);
 
-	Class *c_wc = Unit::lookupClass(s_MongoDriverWriteConcern_className.get());
-	assert(c_wc);
+	static Class *c_wc = nullptr;
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_wc, s_MongoDriverWriteConcern_className);
 	Object wc_obj = Object{c_wc};
 	MongoDBDriverWriteConcernData* wc_data = Native::data<HPHP::MongoDBDriverWriteConcernData>(wc_obj.get());
 
+	auto client_guard = Pool::LockClient(data->m_client);
 	wc_data->m_write_concern = mongoc_write_concern_copy(mongoc_client_get_write_concern(data->m_client));
 
 	return wc_obj;
@@ -621,7 +630,12 @@ Object HHVM_METHOD(MongoDBDriverManager, selectServer, const Object &readPrefere
 	mongoc_server_description_t *selected_server = NULL;
 	Object tmp;
 
-	selected_server = mongoc_client_select_server(data->m_client, false, rp_data->m_read_preference, &error);
+	{
+		auto client_guard = Pool::LockClient(data->m_client);
+		selected_server = mongoc_client_select_server(data->m_client, false, rp_data->m_read_preference, &error);
+	}
+
+	/* Not under the lock, as creating the Server takes it again */
 	if (selected_server) {
 		tmp = hippo_mongo_driver_server_create_from_id(data->m_client, mongoc_server_description_id(selected_server));
 		mongoc_server_description_destroy(selected_server);
@@ -19,6 +19,7 @@
 
 #include "../../../bson.h"
 #include "../../../mongodb.h"
+#include "../../../pool.h"
 #include "../../../utils.h"
 
 #include "Command.h"
@@ -61,15 +62,24 @@ hippo_server_description_type_map_t hippo_server_description_type_map[HIPPO_SERV
 	{ HIPPO_SERVER_RS_GHOST, "RSGhost" },
 };
 
+/* A prefetching cursor's thread updates the client's topology, so server
+ * descriptions are only taken while holding the client's lock */
+static mongoc_server_description_t *hippo_server_get_description(mongoc_client_t *client, uint32_t server_id)
+{
+	auto client_guard = Pool::LockClient(client);
+
+	return mongoc_client_get_server_description(client, server_id);
+}
+
 Object hippo_mongo_driver_server_create_from_id(mongoc_client_t *client, uint32_t server_id)
 {
 	static Class* c_server;
 	mongoc_server_description_t *sd;
 
-	c_server = Unit::lookupClass(s_MongoDriverServer_className.get());
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_server, s_MongoDriverServer_className);
 	Object tmp = Object{c_server};
 
-	sd = mongoc_client_get_server_description(client, server_id);
+	sd = hippo_server_get_description(client, server_id);
 
 	if (!sd) {
 		throw MongoDriver::Utils::CreateAndConstruct(
@@ -158,7 +168,7 @@ Array HHVM_METHOD(MongoDBDriverServer, __debugInfo)
 
 	Array retval = Array::Create();
 
-	if ((sd = mongoc_client_get_server_description(data->m_client, data->m_server_id))) {
+	if ((sd = hippo_server_get_description(data->m_client, data->m_server_id))) {
 		mongodb_driver_add_server_debug(sd, &retval);
 
 		mongoc_server_description_destroy(sd);
@@ -173,7 +183,7 @@ String HHVM_METHOD(MongoDBDriverServer, getHost)
 	MongoDBDriverServerData* data = Native::data<MongoDBDriverServerData>(this_);
 	mongoc_server_description_t *sd;
 
-	if ((sd = mongoc_client_get_server_description(data->m_client, data->m_server_id))) {
+	if ((sd = hippo_server_get_description(data->m_client, data->m_server_id))) {
 		String host(mongoc_server_description_host(sd)->host);
 		mongoc_server_description_destroy(sd);
 
@@ -188,7 +198,7 @@ Array HHVM_METHOD(MongoDBDriverServer, getInfo)
 	MongoDBDriverServerData* data = Native::data<MongoDBDriverServerData>(this_);
 	mongoc_server_description_t *sd;
 
-	if ((sd = mongoc_client_get_server_description(data->m_client, data->m_server_id))) {
+	if ((sd = hippo_server_get_description(data->m_client, data->m_server_id))) {
 		const bson_t       *is_master = mongoc_server_description_ismaster(sd);
 
 		Variant v;
@@ -216,7 +226,7 @@ int64_t HHVM_METHOD(MongoDBDriverServer, getLatency)
 	MongoDBDriverServerData* data = Native::data<MongoDBDriverServerData>(this_);
 	mongoc_server_description_t *sd;
 
-	if ((sd = mongoc_client_get_server_description(data->m_client, data->m_server_id))) {
+	if ((sd = hippo_server_get_description(data->m_client, data->m_server_id))) {
 		int64_t round_trip;
 
 		round_trip = mongoc_server_description_round_trip_time(sd);
@@ -234,7 +244,7 @@ int64_t HHVM_METHOD(MongoDBDriverServer, getPort)
 	MongoDBDriverServerData* data = Native::data<MongoDBDriverServerData>(this_);
 	mongoc_server_description_t *sd;
 
-	if ((sd = mongoc_client_get_server_description(data->m_client, data->m_server_id))) {
+	if ((sd = hippo_server_get_description(data->m_client, data->m_server_id))) {
 		int64_t port;
 
 		port = mongoc_server_description_host(sd)->port;
@@ -251,7 +261,7 @@ Array HHVM_METHOD(MongoDBDriverServer, getTags)
 	MongoDBDriverServerData* data = Native::data<MongoDBDriverServerData>(this_);
 	mongoc_server_description_t *sd;
 
-	if ((sd = mongoc_client_get_server_description(data->m_client, data->m_server_id))) {
+	if ((sd = hippo_server_get_description(data->m_client, data->m_server_id))) {
 		const bson_t       *is_master = mongoc_server_description_ismaster(sd);
 
 		Variant v_last_is_master;
@@ -288,7 +298,7 @@ int64_t HHVM_METHOD(MongoDBDriverServer, getType)
 	MongoDBDriverServerData* data = Native::data<MongoDBDriverServerData>(this_);
 	mongoc_server_description_t *sd;
 
-	if ((sd = mongoc_client_get_server_description(data->m_client, data->m_server_id))) {
+	if ((sd = hippo_server_get_description(data->m_client, data->m_server_id))) {
 		int type;
 
 		type = hippo_server_description_type(sd);
@@ -306,7 +316,7 @@ bool HHVM_METHOD(MongoDBDriverServer, isPrimary)
 	MongoDBDriverServerData* data = Native::data<MongoDBDriverServerData>(this_);
 	mongoc_server_description_t *sd;
 
-	if ((sd = mongoc_client_get_server_description(data->m_client, data->m_server_id))) {
+	if ((sd = hippo_server_get_description(data->m_client, data->m_server_id))) {
 		bool isType;
 
 		isType = (strcmp(mongoc_server_description_type(sd), hippo_server_description_type_map[HIPPO_SERVER_RS_PRIMARY].name) == 0);
@@ -324,7 +334,7 @@ bool HHVM_METHOD(MongoDBDriverServer, isSecondary)
 	MongoDBDriverServerData* data = Native::data<MongoDBDriverServerData>(this_);
 	mongoc_server_description_t *sd;
 
-	if ((sd = mongoc_client_get_server_description(data->m_client, data->m_server_id))) {
+	if ((sd = hippo_server_get_description(data->m_client, data->m_server_id))) {
 		bool isType;
 
 		isType = (strcmp(mongoc_server_description_type(sd), hippo_server_description_type_map[HIPPO_SERVER_RS_SECONDARY].name) == 0);
@@ -342,7 +352,7 @@ bool HHVM_METHOD(MongoDBDriverServer, isArbiter)
 	MongoDBDriverServerData* data = Native::data<MongoDBDriverServerData>(this_);
 	mongoc_server_description_t *sd;
 
-	if ((sd = mongoc_client_get_server_description(data->m_client, data->m_server_id))) {
+	if ((sd = hippo_server_get_description(data->m_client, data->m_server_id))) {
 		bool isType;
 
 		isType = (strcmp(mongoc_server_description_type(sd), hippo_server_description_type_map[HIPPO_SERVER_RS_ARBITER].name) == 0);
@@ -360,7 +370,7 @@ bool HHVM_METHOD(MongoDBDriverServer, isHidden)
 	MongoDBDriverServerData* data = Native::data<MongoDBDriverServerData>(this_);
 	mongoc_server_description_t *sd;
 
-	if ((sd = mongoc_client_get_server_description(data->m_client, data->m_server_id))) {
+	if ((sd = hippo_server_get_description(data->m_client, data->m_server_id))) {
 		bson_iter_t iter;
 
 		const bson_t *is_master = mongoc_server_description_ismaster(sd);
@@ -379,7 +389,7 @@ bool HHVM_METHOD(MongoDBDriverServer, isPassive)
 	MongoDBDriverServerData* data = Native::data<MongoDBDriverServerData>(this_);
 	mongoc_server_description_t *sd;
 
-	if ((sd = mongoc_client_get_server_description(data->m_client, data->m_server_id))) {
+	if ((sd = hippo_server_get_description(data->m_client, data->m_server_id))) {
 		bson_iter_t iter;
 
 		const bson_t *is_master = mongoc_server_description_ismaster(sd);
@@ -430,6 +440,8 @@ Object HHVM_METHOD(MongoDBDriverServer, executeBulkWrite, const String &ns, cons
 		write_concern = wc_data->m_write_concern;
 	}
 	if (!write_concern) {
+		auto client_guard = Pool::LockClient(data->m_client);
+
 		write_concern = mongoc_client_get_write_concern(data->m_client);
 	}
 
@@ -74,8 +74,7 @@ Object hippo_write_result_init(bson_t *reply, bson_error_t *error, mongoc_client
 {
 	static Class* c_writeResult;
 
-	c_writeResult = Unit::lookupClass(s_MongoDriverWriteResult_className.get());
-	assert(c_writeResult);
+	HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_writeResult, s_MongoDriverWriteResult_className);
 	Object obj = Object{c_writeResult};
 
 	MongoDBDriverWriteResultData* wr_data = Native::data<MongoDBDriverWriteResultData>(obj.get());
@@ -123,8 +122,7 @@ Object hippo_write_result_init(bson_t *reply, bson_error_t *error, mongoc_client
 
 			Array a_we = value.toArray();
 
-			c_writeError = Unit::lookupClass(s_MongoDriverWriteError_className.get());
-			assert(c_writeError);
+			HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_writeError, s_MongoDriverWriteError_className);
 			Object we_obj = Object{c_writeError};
 
 			if (a_we.exists(s_errmsg)) {
@@ -153,8 +151,7 @@ Object hippo_write_result_init(bson_t *reply, bson_error_t *error, mongoc_client
 	
 		static Class* c_writeConcernError;
 
-		c_writeConcernError = Unit::lookupClass(s_MongoDriverWriteConcernError_className.get());
-		assert(c_writeConcernError);
+		HIPPO_LOOKUP_SYSTEMLIB_CLASS(c_writeConcernError, s_MongoDriverWriteConcernError_className);
 		Object wce_obj = Object{c_writeConcernError};
 
 		if (a_v.exists(0) && a_v[0].isArray()) {
@@ -0,0 +1,55 @@
+--TEST--
+MongoDB\Driver\Cursor: a document that fails to decode is not replaced by the previous one
+--FILE--
+<?php
+class Picky implements MongoDB\BSON\Unserializable
+{
+	function bsonUnserialize( array $data )
+	{
+		if ( $data['_id'] == 1 ) {
+			throw new Exception( "Can not unserialize document {$data['_id']}" );
+		}
+	}
+}
+
+$m = new MongoDB\Driver\Manager("mongodb://localhost:27017");
+
+$c = new MongoDB\Driver\Command( [ 'drop' => 'test'] );
+try {
+	$m->executeCommand( 'demo', $c );
+}
+catch ( MongoDB\Driver\Exception\RuntimeException $e )
+{
+	// Ignore "ns not found" errors
+	if ( $e->getCode() == 59 ) {
+		throw $e;
+	}
+}
+
+$bw = new MongoDB\Driver\BulkWrite;
+for ( $i = 0; $i < 3; $i++ )
+{
+	$bw->insert( [ '_id' => $i ] );
+}
+$m->executeBulkWrite( 'demo.test', $bw );
+
+$q = new MongoDB\Driver\Query( [], [ 'sort' => [ '_id' => 1 ] ] );
+$cursor = $m->executeQuery( 'demo.test', $q );
+$cursor->setTypeMap( [ 'root' => 'Picky' ] );
+
+var_dump( get_class( $cursor->current() ) );
+$cursor->next();
+
+for ( $i = 0; $i < 2; $i++ )
+{
+	try {
+		$cursor->current();
+	} catch ( Exception $e ) {
+		echo $e->getMessage(), "\n";
+	}
+}
+?>
+--EXPECT--
+string(5) "Picky"
+Can not unserialize document 1
+Can not unserialize document 1
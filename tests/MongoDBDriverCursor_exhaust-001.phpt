@@ -0,0 +1,57 @@
+--TEST--
+MongoDB\Driver\Cursor: exhaust cursors
+--FILE--
+<?php
+$m = new MongoDB\Driver\Manager("mongodb://localhost:27017");
+
+$c = new MongoDB\Driver\Command( [ 'drop' => 'test'] );
+try {
+	$m->executeCommand( 'demo', $c );
+}
+catch ( MongoDB\Driver\Exception\RuntimeException $e )
+{
+	// Ignore "ns not found" errors
+	if ( $e->getCode() == 59 ) {
+		throw $e;
+	}
+}
+
+$bw = new MongoDB\Driver\BulkWrite;
+for ( $i = 0; $i < 10; $i++ )
+{
+	$bw->insert( [ '_id' => $i ] );
+}
+$m->executeBulkWrite( 'demo.test', $bw );
+
+$q = new MongoDB\Driver\Query( [], [ 'batchSize' => 2, 'sort' => [ '_id' => 1 ], 'exhaust' => true ] );
+
+$cursor = $m->executeQuery( 'demo.test', $q );
+foreach ( $cursor as $key => $result )
+{
+	echo $key, ': ', $result->_id, "\n";
+}
+var_dump( $cursor->isDead() );
+
+/* Abandoning an exhaust cursor part way through must leave the client usable */
+$cursor = $m->executeQuery( 'demo.test', $q );
+$cursor->rewind();
+$cursor->next();
+var_dump( $cursor->current()->_id );
+unset( $cursor );
+
+var_dump( count( $m->executeQuery( 'demo.test', new MongoDB\Driver\Query( [] ) )->toArray() ) );
+?>
+--EXPECT--
+0: 0
+1: 1
+2: 2
+3: 3
+4: 4
+5: 5
+6: 6
+7: 7
+8: 8
+9: 9
+bool(true)
+int(1)
+int(10)
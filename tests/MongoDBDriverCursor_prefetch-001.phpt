@@ -0,0 +1,74 @@
+--TEST--
+MongoDB\Driver\Cursor: prefetching batches
+--FILE--
+<?php
+$m = new MongoDB\Driver\Manager("mongodb://localhost:27017");
+
+$c = new MongoDB\Driver\Command( [ 'drop' => 'test'] );
+try {
+	$m->executeCommand( 'demo', $c );
+}
+catch ( MongoDB\Driver\Exception\RuntimeException $e )
+{
+	// Ignore "ns not found" errors
+	if ( $e->getCode() == 59 ) {
+		throw $e;
+	}
+}
+
+$bw = new MongoDB\Driver\BulkWrite;
+for ( $i = 0; $i < 10; $i++ )
+{
+	$bw->insert( [ '_id' => $i, 'x' => str_repeat( 'x', $i ) ] );
+}
+$m->executeBulkWrite( 'demo.test', $bw );
+
+/* A tiny cap, so that the prefetch thread has to wait for PHP to catch up */
+$q = new MongoDB\Driver\Query( [], [ 'batchSize' => 3, 'sort' => [ '_id' => 1 ], 'prefetch' => true, 'prefetchMaxBytes' => 32 ] );
+$cursor = $m->executeQuery( 'demo.test', $q );
+$cursor->setTypeMap( [ 'root' => 'array' ] );
+
+foreach ( $cursor as $key => $result )
+{
+	echo $key, ': ', $result['_id'], ' ', strlen( $result['x'] ), "\n";
+
+	/* Other operations on the same client wait for the prefetch thread */
+	if ( $key == 4 ) {
+		$m->executeQuery( 'demo.test', new MongoDB\Driver\Query( [ '_id' => 0 ] ) )->toArray();
+	}
+}
+
+/* Without setTypeMap(), the first document must still be the right one */
+$cursor = $m->executeQuery( 'demo.test', $q );
+$cursor->rewind();
+var_dump( $cursor->current()->_id );
+
+$cursor = $m->executeQuery( 'demo.test', $q );
+echo implode( ',', array_map( function( $d ) { return $d->_id; }, $cursor->toArray() ) ), "\n";
+
+/* Abandoning a prefetching cursor part way through */
+$cursor = $m->executeQuery( 'demo.test', $q );
+$cursor->rewind();
+$cursor->next();
+var_dump( $cursor->current()->_id );
+unset( $cursor );
+
+$cursor = $m->executeQuery( 'demo.test', new MongoDB\Driver\Query( [ '_id' => 42 ], [ 'prefetch' => true ] ) );
+var_dump( $cursor->toArray() );
+?>
+--EXPECT--
+0: 0 0
+1: 1 1
+2: 2 2
+3: 3 3
+4: 4 4
+5: 5 5
+6: 6 6
+7: 7 7
+8: 8 8
+9: 9 9
+int(0)
+0,1,2,3,4,5,6,7,8,9
+int(1)
+array(0) {
+}
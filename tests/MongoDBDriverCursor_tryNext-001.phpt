@@ -0,0 +1,80 @@
+--TEST--
+MongoDB\Driver\Cursor::tryNext() with a tailable awaitData cursor
+--FILE--
+<?php
+$m = new MongoDB\Driver\Manager("mongodb://localhost:27017");
+
+$c = new MongoDB\Driver\Command( [ 'drop' => 'capped'] );
+try {
+	$m->executeCommand( 'demo', $c );
+}
+catch ( MongoDB\Driver\Exception\RuntimeException $e )
+{
+	// Ignore "ns not found" errors
+	if ( $e->getCode() == 59 ) {
+		throw $e;
+	}
+}
+$m->executeCommand( 'demo', new MongoDB\Driver\Command( [ 'create' => 'capped', 'capped' => true, 'size' => 4096 ] ) );
+
+$bw = new MongoDB\Driver\BulkWrite;
+for ( $i = 0; $i < 3; $i++ )
+{
+	$bw->insert( [ '_id' => $i ] );
+}
+$m->executeBulkWrite( 'demo.capped', $bw );
+
+$q = new MongoDB\Driver\Query( [], [ 'tailable' => true, 'awaitData' => true, 'maxAwaitTimeMS' => 100 ] );
+$cursor = $m->executeQuery( 'demo.capped', $q );
+
+$cursor->rewind();
+while ( $cursor->valid() )
+{
+	echo $cursor->key(), ': ', $cursor->current()->_id, "\n";
+	$cursor->next();
+}
+
+/* No new documents yet, but the cursor is still usable */
+var_dump( $cursor->tryNext() );
+var_dump( $cursor->valid() );
+var_dump( $cursor->isDead() );
+
+$bw = new MongoDB\Driver\BulkWrite;
+$bw->insert( [ '_id' => 3 ] );
+$m->executeBulkWrite( 'demo.capped', $bw );
+
+var_dump( $cursor->tryNext() );
+echo $cursor->key(), ': ', $cursor->current()->_id, "\n";
+
+/* The first document of a cursor whose first batch was empty has key 0,
+ * whether or not the cursor was rewound before it arrived */
+$q = new MongoDB\Driver\Query( [ '_id' => [ '$gte' => 4 ] ], [ 'tailable' => true, 'awaitData' => true ] );
+$rewound = $m->executeQuery( 'demo.capped', $q );
+$rewound->rewind();
+var_dump( $rewound->valid() );
+$plain = $m->executeQuery( 'demo.capped', $q );
+
+$bw = new MongoDB\Driver\BulkWrite;
+$bw->insert( [ '_id' => 4 ] );
+$m->executeBulkWrite( 'demo.capped', $bw );
+
+foreach ( [ $rewound, $plain ] as $tailing )
+{
+	var_dump( $tailing->tryNext() );
+	echo $tailing->key(), ': ', $tailing->current()->_id, "\n";
+}
+?>
+--EXPECT--
+0: 0
+1: 1
+2: 2
+bool(false)
+bool(false)
+bool(false)
+bool(true)
+3: 3
+bool(false)
+bool(true)
+0: 4
+bool(true)
+0: 4
@@ -0,0 +1,23 @@
+--TEST--
+MongoDB\Driver\Query::__construct: invalid arguments [5]
+--FILE--
+<?php
+$data = [
+	0, -1, 3.14, '1024', true, null
+];
+
+foreach ($data as $item) {
+	try {
+		$w = new MongoDB\Driver\Query([], ['prefetch' => true, 'prefetchMaxBytes' => $item]);
+	} catch (\InvalidArgumentException $e) {
+		echo $e->getMessage(), "\n";
+	}
+}
+?>
+--EXPECT--
+Expected "prefetchMaxBytes" option to be positive, 0 given
+Expected "prefetchMaxBytes" option to be positive, -1 given
+Expected "prefetchMaxBytes" option to be integer, double given
+Expected "prefetchMaxBytes" option to be integer, string given
+Expected "prefetchMaxBytes" option to be integer, boolean given
+Expected "prefetchMaxBytes" option to be integer, NULL given
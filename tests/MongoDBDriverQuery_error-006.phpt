@@ -0,0 +1,20 @@
+--TEST--
+MongoDB\Driver\Query::__construct: invalid arguments [6]
+--FILE--
+<?php
+$options = [
+	[ 'exhaust' => true, 'limit' => 5 ],
+	[ 'flags' => MongoDB\Driver\Query::FLAG_EXHAUST, 'limit' => -1 ],
+];
+
+foreach ($options as $item) {
+	try {
+		$w = new MongoDB\Driver\Query([], $item);
+	} catch (\InvalidArgumentException $e) {
+		echo $e->getMessage(), "\n";
+	}
+}
+?>
+--EXPECT--
+Exhaust cursors can not be combined with the "limit" option
+Exhaust cursors can not be combined with the "limit" option
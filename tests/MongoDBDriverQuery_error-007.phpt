@@ -0,0 +1,28 @@
+--TEST--
+MongoDB\Driver\Query::__construct: invalid arguments [7]
+--FILE--
+<?php
+$options = [
+	[ 'awaitData' => true ],
+	[ 'flags' => MongoDB\Driver\Query::FLAG_AWAIT_DATA ],
+	[ 'tailable' => true, 'maxAwaitTimeMS' => 100 ],
+	[ 'tailable' => true, 'awaitData' => true, 'maxAwaitTimeMS' => -1 ],
+	[ 'tailable' => true, 'awaitData' => true, 'maxAwaitTimeMS' => '100' ],
+	[ 'tailable' => true, 'prefetch' => true ],
+];
+
+foreach ($options as $item) {
+	try {
+		$w = new MongoDB\Driver\Query([], $item);
+	} catch (\InvalidArgumentException $e) {
+		echo $e->getMessage(), "\n";
+	}
+}
+?>
+--EXPECT--
+The "awaitData" option requires a tailable cursor
+The "awaitData" option requires a tailable cursor
+The "maxAwaitTimeMS" option requires the "awaitData" option
+Expected "maxAwaitTimeMS" option to be non-negative, -1 given
+Expected "maxAwaitTimeMS" option to be integer, string given
+The "prefetch" option can not be used with tailable cursors
@@ -0,0 +1,79 @@
+--TEST--
+BSON decoding with the 'hydrate' type map option
+--FILE--
+<?php
+class Address implements MongoDB\BSON\Unserializable
+{
+	public $city;
+
+	function bsonUnserialize( array $data )
+	{
+		echo "Address::bsonUnserialize called\n";
+	}
+}
+
+class Person implements MongoDB\BSON\Persistable
+{
+	public $name;
+	protected $age;
+	private $address;
+
+	function __construct()
+	{
+		echo "Person::__construct called\n";
+	}
+
+	function bsonSerialize()
+	{
+		return [ 'name' => $this->name, 'age' => 42, 'address' => [ 'city' => 'London' ], 'extra' => true ];
+	}
+
+	function bsonUnserialize( array $data )
+	{
+		echo "Person::bsonUnserialize called\n";
+	}
+}
+
+$person = new Person;
+$person->name = 'Derick';
+
+$bson = MongoDB\BSON\fromPHP( $person );
+
+var_dump( MongoDB\BSON\toPHP( $bson, [ 'document' => 'Address', 'hydrate' => true ] ) );
+var_dump( MongoDB\BSON\toPHP( $bson, [ 'root' => 'array', 'document' => 'Address', 'hydrate' => true ] ) );
+?>
+--EXPECTF--
+Person::__construct called
+object(Person)#%d (5) {
+  ["name"]=>
+  string(6) "Derick"
+  ["age":protected]=>
+  int(42)
+  ["address":"Person":private]=>
+  object(Address)#%d (1) {
+    ["city"]=>
+    string(6) "London"
+  }
+  ["extra"]=>
+  bool(true)
+}
+array(5) {
+  ["name"]=>
+  string(6) "Derick"
+  ["age"]=>
+  int(42)
+  ["address"]=>
+  object(Address)#%d (1) {
+    ["city"]=>
+    string(6) "London"
+  }
+  ["extra"]=>
+  bool(true)
+  ["__pclass"]=>
+  object(MongoDB\BSON\Binary)#%d (2) {
+    ["data"]=>
+    string(6) "Person"
+    ["type"]=>
+    int(128)
+  }
+}
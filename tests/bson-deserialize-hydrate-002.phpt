@@ -0,0 +1,53 @@
+--TEST--
+BSON decoding with the 'hydrate' type map option: parent properties and __set()
+--FILE--
+<?php
+class Base
+{
+	private $secret;
+	protected $level;
+}
+
+class Account extends Base implements MongoDB\BSON\Unserializable
+{
+	public $owner;
+
+	function __set( $name, $value )
+	{
+		echo "Account::__set called for $name\n";
+	}
+
+	function bsonUnserialize( array $data )
+	{
+		echo "Account::bsonUnserialize called\n";
+	}
+}
+
+$bson = MongoDB\BSON\fromPHP( [ 'owner' => 'Derick', 'secret' => 'hunter2', 'level' => 3, 'extra' => true ] );
+
+for ( $i = 0; $i < 2; $i++ )
+{
+	var_dump( MongoDB\BSON\toPHP( $bson, [ 'root' => 'Account', 'hydrate' => true ] ) );
+}
+?>
+--EXPECTF--
+object(Account)#%d (4) {
+  ["secret":"Base":private]=>
+  string(7) "hunter2"
+  ["level":protected]=>
+  int(3)
+  ["owner"]=>
+  string(6) "Derick"
+  ["extra"]=>
+  bool(true)
+}
+object(Account)#%d (4) {
+  ["secret":"Base":private]=>
+  string(7) "hunter2"
+  ["level":protected]=>
+  int(3)
+  ["owner"]=>
+  string(6) "Derick"
+  ["extra"]=>
+  bool(true)
+}
@@ -0,0 +1,54 @@
+--TEST--
+BSON decoding with a 'projection' type map option
+--FILE--
+<?php
+$bson = MongoDB\BSON\fromPHP( [
+	'_id' => 1,
+	'name' => 'Derick',
+	'address' => [ 'city' => 'London', 'country' => 'UK' ],
+	'tags' => [ [ 'k' => 'a', 'v' => 1 ], [ 'k' => 'b', 'v' => 2 ] ],
+	'big' => str_repeat( 'x', 1024 ),
+] );
+
+var_dump( MongoDB\BSON\toPHP( $bson, [ 'root' => 'array', 'document' => 'array', 'projection' => [ 'name', 'address.city', 'tags.k' ] ] ) );
+var_dump( MongoDB\BSON\toPHP( $bson, [ 'root' => 'array', 'document' => 'array', 'projection' => [ 'address', 'address.city' ] ] ) );
+
+try {
+	MongoDB\BSON\toPHP( $bson, [ 'projection' => [ 'a..b' ] ] );
+} catch ( MongoDB\Driver\Exception\InvalidArgumentException $e ) {
+	echo $e->getMessage(), "\n";
+}
+?>
+--EXPECT--
+array(3) {
+  ["name"]=>
+  string(6) "Derick"
+  ["address"]=>
+  array(1) {
+    ["city"]=>
+    string(6) "London"
+  }
+  ["tags"]=>
+  array(2) {
+    [0]=>
+    array(1) {
+      ["k"]=>
+      string(1) "a"
+    }
+    [1]=>
+    array(1) {
+      ["k"]=>
+      string(1) "b"
+    }
+  }
+}
+array(1) {
+  ["address"]=>
+  array(2) {
+    ["city"]=>
+    string(6) "London"
+    ["country"]=>
+    string(2) "UK"
+  }
+}
+Projection field paths can not contain empty field names
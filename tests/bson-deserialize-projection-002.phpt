@@ -0,0 +1,41 @@
+--TEST--
+BSON deserialization: projection with duplicate keys and corrupt fields
+--FILE--
+<?php
+/* { "a": 1, "a": 2, "b": 3 } */
+$duplicates = pack( 'V', 26 ) .
+	"\x10a\x00" . pack( 'V', 1 ) .
+	"\x10a\x00" . pack( 'V', 2 ) .
+	"\x10b\x00" . pack( 'V', 3 ) .
+	"\x00";
+
+var_dump( MongoDB\BSON\toPHP( $duplicates, [ 'root' => 'array', 'projection' => [ 'a', 'b' ] ] ) );
+
+/* { "a": "\xff" }, which is not valid UTF-8 */
+$corrupt = pack( 'V', 14 ) . "\x02a\x00" . pack( 'V', 2 ) . "\xff\x00" . "\x00";
+
+foreach ( [ [ 'root' => 'array' ], [ 'root' => 'array', 'projection' => [ 'a' ] ] ] as $typemap )
+{
+	try {
+		var_dump( MongoDB\BSON\toPHP( $corrupt, $typemap ) );
+	} catch ( MongoDB\Driver\Exception\UnexpectedValueException $e ) {
+		echo $e->getMessage(), "\n";
+	}
+}
+
+try {
+	var_dump( MongoDB\BSON\Document::fromBSON( $corrupt )->get( 'a' ) );
+} catch ( MongoDB\Driver\Exception\UnexpectedValueException $e ) {
+	echo $e->getMessage(), "\n";
+}
+?>
+--EXPECT--
+array(2) {
+  ["a"]=>
+  int(2)
+  ["b"]=>
+  int(3)
+}
+Detected corrupt BSON data
+Detected corrupt BSON data
+Detected corrupt BSON data
@@ -0,0 +1,29 @@
+--TEST--
+BSON deserialization: projection does not leak an unresolved __pclass
+--FILE--
+<?php
+$bson = MongoDB\BSON\fromPHP( [
+	'__pclass' => new MongoDB\BSON\Binary( 'NoSuchClass', 0x80 ),
+	'a' => 1,
+	'b' => 2,
+] );
+
+var_dump( MongoDB\BSON\toPHP( $bson, [ 'projection' => [ 'a' ] ] ) );
+var_dump( MongoDB\BSON\toPHP( $bson, [ 'projection' => [ 'a', '__pclass' ] ] ) );
+?>
+--EXPECTF--
+object(stdClass)#%d (1) {
+  ["a"]=>
+  int(1)
+}
+object(stdClass)#%d (2) {
+  ["__pclass"]=>
+  object(MongoDB\BSON\Binary)#%d (2) {
+    ["data"]=>
+    string(11) "NoSuchClass"
+    ["type"]=>
+    int(128)
+  }
+  ["a"]=>
+  int(1)
+}
@@ -0,0 +1,31 @@
+--TEST--
+BSON deserialization: root as raw BSON
+--FILE--
+<?php
+$bson = MongoDB\BSON\fromPHP( [ 'a' => [ 'b' => 42 ], 'list' => [ 1, 2 ], '__pclass' => new MongoDB\BSON\Binary( 'stdClass', 0x80 ) ] );
+
+$raw = MongoDB\BSON\toPHP( $bson, [ 'root' => 'bson' ] );
+var_dump( $raw === $bson );
+
+/* Only the root can be passed through */
+var_dump( MongoDB\BSON\toPHP( $bson, [ 'root' => 'bson', 'document' => 'array' ] ) === $bson );
+
+$typemaps = [
+	[ 'root' => 'BSON' ],
+	[ 'root' => 'array', 'document' => 'bson' ],
+];
+
+foreach ( $typemaps as $typemap )
+{
+	try {
+		var_dump( MongoDB\BSON\toPHP( $bson, $typemap ) === $bson );
+	} catch ( MongoDB\Driver\Exception\InvalidArgumentException $e ) {
+		echo $e->getMessage(), "\n";
+	}
+}
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+Class bson does not exist
@@ -0,0 +1,63 @@
+--TEST--
+MongoDB\BSON\Document gives lazy access to raw BSON
+--FILE--
+<?php
+$bson = MongoDB\BSON\fromPHP( [ 'a' => [ 'b' => [ 'c' => 42 ] ], 'list' => [ 1, 'two', [ 'x' => 3 ] ], 'n' => null ] );
+
+$document = MongoDB\BSON\Document::fromBSON( $bson );
+
+var_dump( $document->get( 'a.b.c' ) );
+var_dump( $document->has( 'a.b' ), $document->has( 'a.x' ), $document->has( 'n' ) );
+var_dump( $document->get( 'missing' ) );
+var_dump( get_class( $document->get( 'a' ) ) );
+var_dump( $document->get( 'a' ) === $document->get( 'a' ) );
+
+$list = $document->get( 'list' );
+var_dump( get_class( $list ) );
+var_dump( $list->get( 1 ), $list->has( 3 ), $list->get( 2 )->get( 'x' ) );
+
+foreach ( $document as $key => $value )
+{
+	echo $key, ': ', is_object( $value ) ? get_class( $value ) : gettype( $value ), "\n";
+}
+
+var_dump( (string) $document === $bson );
+var_dump( MongoDB\BSON\fromPHP( [ 'embedded' => $document ] ) === MongoDB\BSON\fromPHP( [ 'embedded' => MongoDB\BSON\toPHP( $bson ) ] ) );
+var_dump( $document->toPHP( [ 'root' => 'array', 'document' => 'array' ] )['a'] );
+
+$decoded = MongoDB\BSON\toPHP( $bson, [ 'root' => 'MongoDB\BSON\Document', 'array' => 'MongoDB\BSON\PackedArray' ] );
+var_dump( get_class( $decoded ), $decoded->get( 'list.1' ) );
+
+try {
+	MongoDB\BSON\Document::fromBSON( "\x05\x00\x00" );
+} catch ( MongoDB\Driver\Exception\UnexpectedValueException $e ) {
+	echo $e->getMessage(), "\n";
+}
+?>
+--EXPECT--
+int(42)
+bool(true)
+bool(false)
+bool(true)
+NULL
+string(21) "MongoDB\BSON\Document"
+bool(true)
+string(24) "MongoDB\BSON\PackedArray"
+string(3) "two"
+bool(false)
+int(3)
+a: MongoDB\BSON\Document
+list: MongoDB\BSON\PackedArray
+n: NULL
+bool(true)
+bool(true)
+array(1) {
+  ["b"]=>
+  array(1) {
+    ["c"]=>
+    int(42)
+  }
+}
+string(21) "MongoDB\BSON\Document"
+string(3) "two"
+Could not read document from BSON reader
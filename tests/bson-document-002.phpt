@@ -0,0 +1,25 @@
+--TEST--
+MongoDB\BSON\Document and PackedArray cache iterated elements
+--FILE--
+<?php
+$bson = MongoDB\BSON\fromPHP( [ 'a' => [ 'b' => 1 ], 'list' => [ [ 'x' => 1 ], [ 'x' => 2 ] ] ] );
+$document = MongoDB\BSON\Document::fromBSON( $bson );
+
+$first = iterator_to_array( $document );
+$second = iterator_to_array( $document );
+var_dump( $first['a'] === $second['a'] );
+var_dump( $first['a'] === $document->get( 'a' ) );
+
+/* Values fetched before iterating are reused too */
+$list = $document->get( 'list' );
+$element = $list->get( 1 );
+var_dump( iterator_to_array( $document )['list'] === $list );
+var_dump( iterator_to_array( $list )[1] === $element );
+var_dump( iterator_to_array( $list )[0] === $list->get( 0 ) );
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
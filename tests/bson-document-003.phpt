@@ -0,0 +1,28 @@
+--TEST--
+MongoDB\BSON\Document and PackedArray type map values for Javascript scopes and PackedArray::toPHP()
+--FILE--
+<?php
+$bson = MongoDB\BSON\fromPHP( [ 'code' => new MongoDB\BSON\Javascript( 'return x;', [ 'x' => 42 ] ) ] );
+
+$decoded = MongoDB\BSON\toPHP( $bson, [ 'document' => 'MongoDB\BSON\Document' ] );
+$scope = $decoded->code->__debugInfo()['scope'];
+var_dump( get_class( $scope ), $scope->get( 'x' ) );
+var_dump( MongoDB\BSON\fromPHP( $decoded ) === $bson );
+
+$bson = MongoDB\BSON\fromPHP( [ 'list' => [ 1, [ 2, 3 ] ] ] );
+$list = MongoDB\BSON\Document::fromBSON( $bson )->get( 'list' );
+
+$copy = $list->toPHP( [ 'array' => 'MongoDB\BSON\PackedArray' ] );
+var_dump( get_class( $copy ), $copy->get( 0 ), (string) $copy === (string) $list );
+
+$nested = $list->toPHP( [ 'root' => 'array', 'array' => 'MongoDB\BSON\PackedArray' ] );
+var_dump( get_class( $nested ) );
+?>
+--EXPECT--
+string(21) "MongoDB\BSON\Document"
+int(42)
+bool(true)
+string(24) "MongoDB\BSON\PackedArray"
+int(1)
+bool(true)
+string(24) "MongoDB\BSON\PackedArray"
@@ -0,0 +1,39 @@
+--TEST--
+MongoDB\BSON\toCanonicalExtendedJSON() and toRelaxedExtendedJSON()
+--FILE--
+<?php
+$bson = MongoDB\BSON\fromPHP( [
+	'int' => 1,
+	'long' => 1099511627776,
+	'double' => 1.0,
+	'pi' => 3.14,
+	'str' => "a\"b\n",
+	'bool' => true,
+	'null' => null,
+	'arr' => [ 1, 2 ],
+	'empty' => [],
+	'oid' => new MongoDB\BSON\ObjectID( '56315a7c6118fd1b920270b1' ),
+	'date' => new MongoDB\BSON\UTCDateTime( 1416445411987 ),
+	'bin' => new MongoDB\BSON\Binary( 'foo', 0 ),
+	'regex' => new MongoDB\BSON\Regex( '^a', 'i' ),
+	'unsorted' => new MongoDB\BSON\Regex( 'b', 'xmi' ),
+	'ts' => new MongoDB\BSON\Timestamp( 1234, 5678 ),
+] );
+
+echo MongoDB\BSON\toCanonicalExtendedJSON( $bson ), "\n";
+echo MongoDB\BSON\toRelaxedExtendedJSON( $bson ), "\n";
+echo MongoDB\BSON\toRelaxedExtendedJSON( MongoDB\BSON\fromPHP( [ 'inf' => INF, 'd' => new MongoDB\BSON\UTCDateTime( -1 ) ] ) ), "\n";
+echo MongoDB\BSON\toRelaxedExtendedJSON( MongoDB\BSON\fromJSON( '{ "a" : [ { "b" : 1.5 } ] }' ) ), "\n";
+
+try {
+	MongoDB\BSON\toCanonicalExtendedJSON( $bson . "\x00" );
+} catch ( MongoDB\Driver\Exception\UnexpectedValueException $e ) {
+	echo $e->getMessage(), "\n";
+}
+?>
+--EXPECT--
+{ "int" : { "$numberInt" : "1" }, "long" : { "$numberLong" : "1099511627776" }, "double" : { "$numberDouble" : "1.0" }, "pi" : { "$numberDouble" : "3.14" }, "str" : "a\"b\n", "bool" : true, "null" : null, "arr" : [ { "$numberInt" : "1" }, { "$numberInt" : "2" } ], "empty" : [ ], "oid" : { "$oid" : "56315a7c6118fd1b920270b1" }, "date" : { "$date" : { "$numberLong" : "1416445411987" } }, "bin" : { "$binary" : { "base64" : "Zm9v", "subType" : "00" } }, "regex" : { "$regularExpression" : { "pattern" : "^a", "options" : "i" } }, "unsorted" : { "$regularExpression" : { "pattern" : "b", "options" : "imx" } }, "ts" : { "$timestamp" : { "t" : 5678, "i" : 1234 } } }
+{ "int" : 1, "long" : 1099511627776, "double" : 1.0, "pi" : 3.14, "str" : "a\"b\n", "bool" : true, "null" : null, "arr" : [ 1, 2 ], "empty" : [ ], "oid" : { "$oid" : "56315a7c6118fd1b920270b1" }, "date" : { "$date" : "2014-11-20T01:03:31.987Z" }, "bin" : { "$binary" : { "base64" : "Zm9v", "subType" : "00" } }, "regex" : { "$regularExpression" : { "pattern" : "^a", "options" : "i" } }, "unsorted" : { "$regularExpression" : { "pattern" : "b", "options" : "imx" } }, "ts" : { "$timestamp" : { "t" : 5678, "i" : 1234 } } }
+{ "inf" : { "$numberDouble" : "Infinity" }, "d" : { "$date" : { "$numberLong" : "-1" } } }
+{ "a" : [ { "b" : 1.5 } ] }
+Reading document did not exhaust input buffer
@@ -0,0 +1,25 @@
+--TEST--
+MongoDB\BSON\fromJSON(): Extended JSON type wrappers and malformed input
+--FILE--
+<?php
+$json = '{ "oid" : { "$oid" : "56315a7c6118fd1b920270b1" }, "legacy" : { "$type" : "80", "$binary" : "Zm9v" }, "bin" : { "$binary" : { "base64" : "Zm9v", "subType" : "00" } }, "date" : { "$date" : "2014-11-20T01:03:31.987Z" }, "long" : { "$numberLong" : "42" }, "int" : 7, "big" : 4294967296, "str" : "é\t", "regex" : { "$regex" : "^a", "$options" : "i" }, "ts" : { "$timestamp" : { "t" : 5678, "i" : 1234 } }, "max" : { "$maxKey" : 1 }, "code" : { "$code" : "f()", "$scope" : { "a" : 1 } }, "query" : { "$type" : "string" } }';
+
+echo MongoDB\BSON\toCanonicalExtendedJSON( MongoDB\BSON\fromJSON( $json ) ), "\n";
+
+foreach ( [ '', '[ 1 ]', '{ "a" 1 }', '{ "a" : 01 }', '{ "a" : "\x" }', '{ "a" : { "$oid" : "zz" } }' ] as $json )
+{
+	try {
+		MongoDB\BSON\fromJSON( $json );
+	} catch ( MongoDB\Driver\Exception\UnexpectedValueException $e ) {
+		echo $e->getMessage(), "\n";
+	}
+}
+?>
+--EXPECT--
+{ "oid" : { "$oid" : "56315a7c6118fd1b920270b1" }, "legacy" : { "$binary" : { "base64" : "Zm9v", "subType" : "80" } }, "bin" : { "$binary" : { "base64" : "Zm9v", "subType" : "00" } }, "date" : { "$date" : { "$numberLong" : "1416445411987" } }, "long" : { "$numberLong" : "42" }, "int" : { "$numberInt" : "7" }, "big" : { "$numberLong" : "4294967296" }, "str" : "é\t", "regex" : { "$regularExpression" : { "pattern" : "^a", "options" : "i" } }, "ts" : { "$timestamp" : { "t" : 5678, "i" : 1234 } }, "max" : { "$maxKey" : 1 }, "code" : { "$code" : "f()", "$scope" : { "a" : { "$numberInt" : "1" } } }, "query" : { "$type" : "string" } }
+Empty JSON string
+Error parsing JSON at position 0: Expected a JSON object
+Error parsing JSON at position 6: Expected ':'
+Error parsing JSON at position 9: Expected '}'
+Error parsing JSON at position 9: Invalid escape
+Error parsing JSON at position 23: Invalid $oid
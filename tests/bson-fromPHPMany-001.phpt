@@ -0,0 +1,38 @@
+--TEST--
+MongoDB\BSON\fromPHPMany() encodes documents into one buffer
+--FILE--
+<?php
+$documents = [ [ 'n' => 1 ], (object) [ 'n' => 2, 's' => 'two' ], [ 'n' => 3 ] ];
+
+$bson = MongoDB\BSON\fromPHPMany( $documents, $offsets );
+var_dump( $offsets );
+var_dump( $bson === MongoDB\BSON\fromPHP( $documents[0] ) . MongoDB\BSON\fromPHP( $documents[1] ) . MongoDB\BSON\fromPHP( $documents[2] ) );
+
+foreach ( MongoDB\BSON\readDocuments( MongoDB\BSON\fromPHPMany( new ArrayIterator( $documents ) ) ) as $offset => $document )
+{
+	echo $offset, ': ', $document->n, "\n";
+}
+
+var_dump( MongoDB\BSON\fromPHPMany( [] ) );
+
+try {
+	MongoDB\BSON\fromPHPMany( [ [ 'n' => 1 ], 42 ] );
+} catch ( MongoDB\Driver\Exception\InvalidArgumentException $e ) {
+	echo $e->getMessage(), "\n";
+}
+?>
+--EXPECTF--
+array(3) {
+  [0]=>
+  int(0)
+  [1]=>
+  int(12)
+  [2]=>
+  int(35)
+}
+bool(true)
+0: 1
+12: 2
+35: 3
+string(0) ""
+Expected document 1 to be an array or object, %s given
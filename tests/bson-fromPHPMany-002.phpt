@@ -0,0 +1,35 @@
+--TEST--
+MongoDB\BSON\fromPHPMany() grows its buffer at document boundaries
+--FILE--
+<?php
+/* Documents of every size around the initial estimate, so that some of them
+ * end right at (or just short of) the end of the buffer */
+$failures = 0;
+
+for ( $count = 1; $count <= 24; $count++ )
+{
+	for ( $padding = 0; $padding <= 80; $padding++ )
+	{
+		$documents = [];
+		for ( $i = 0; $i < $count; $i++ )
+		{
+			$documents[] = [ 'x' => str_repeat( 'a', $padding + $i ) ];
+		}
+
+		$expected = '';
+		foreach ( $documents as $document )
+		{
+			$expected .= MongoDB\BSON\fromPHP( $document );
+		}
+
+		if ( MongoDB\BSON\fromPHPMany( $documents ) !== $expected ) {
+			echo "Mismatch for $count documents with $padding bytes of padding\n";
+			$failures++;
+		}
+	}
+}
+
+var_dump( $failures );
+?>
+--EXPECT--
+int(0)
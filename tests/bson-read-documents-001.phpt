@@ -0,0 +1,42 @@
+--TEST--
+MongoDB\BSON\readDocuments() reads concatenated documents from a string or stream
+--FILE--
+<?php
+$bson = MongoDB\BSON\fromPHP( [ 'n' => 1 ] ) . MongoDB\BSON\fromPHP( [ 'n' => 2, 's' => 'two' ] ) . MongoDB\BSON\fromPHP( [ 'n' => 3 ] );
+
+foreach ( MongoDB\BSON\readDocuments( $bson, [ 'root' => 'array' ] ) as $offset => $document )
+{
+	echo $offset, ': ', json_encode( $document ), "\n";
+}
+
+$file = tempnam( sys_get_temp_dir(), 'bson' );
+file_put_contents( $file, $bson );
+$fp = fopen( $file, 'r' );
+fseek( $fp, 12 );
+
+$reader = MongoDB\BSON\readDocuments( $fp );
+foreach ( $reader as $offset => $document )
+{
+	echo $offset, ': ', $document->n, "\n";
+}
+fclose( $fp );
+unlink( $file );
+
+try {
+	foreach ( MongoDB\BSON\readDocuments( substr( $bson, 0, -3 ) ) as $document )
+	{
+		echo $document->n, "\n";
+	}
+} catch ( MongoDB\Driver\Exception\UnexpectedValueException $e ) {
+	echo $e->getMessage(), "\n";
+}
+?>
+--EXPECT--
+0: {"n":1}
+12: {"n":2,"s":"two"}
+35: {"n":3}
+12: 2
+35: 3
+1
+2
+Could not read document from BSON reader at offset 35
@@ -0,0 +1,37 @@
+--TEST--
+BSON encoding: plain arrays and objects are encoded without allocating keys
+--SKIPIF--
+<?php if (MongoDB\BSON\_keyAllocations() === NULL) exit("skip needs a debug build"); ?>
+--FILE--
+<?php
+class Point
+{
+	public $x = 1;
+	public $y = 2;
+	protected $hidden = 3;
+}
+
+$point = new Point;
+$point->z = 3;
+
+$documents = [
+	[ 'a' => 1, 'b' => 'two', 'c' => [ 1, 2, 3 ], 42 => true ],
+	(object) [ 'a' => 1, 'nested' => (object) [ 'b' => 2 ] ],
+	$point,
+];
+
+$before = MongoDB\BSON\_keyAllocations();
+foreach ( $documents as $document )
+{
+	MongoDB\BSON\fromPHP( $document );
+}
+var_dump( MongoDB\BSON\_keyAllocations() - $before );
+
+/* Collections are copied into an array first */
+$before = MongoDB\BSON\_keyAllocations();
+MongoDB\BSON\fromPHP( [ 'map' => new HH\Map( [ 'a' => 1, 'b' => 2 ] ) ] );
+var_dump( MongoDB\BSON\_keyAllocations() - $before );
+?>
+--EXPECT--
+int(0)
+int(3)
@@ -0,0 +1,42 @@
+--TEST--
+MongoDB\BSON value types compare by value
+--FILE--
+<?php
+$pairs = [
+	[ new MongoDB\BSON\Binary( 'foo', 0 ), new MongoDB\BSON\Binary( 'foo', 0 ), new MongoDB\BSON\Binary( 'bar', 0 ) ],
+	[ new MongoDB\BSON\Javascript( 'f()' ), new MongoDB\BSON\Javascript( 'f()' ), new MongoDB\BSON\Javascript( 'g()' ) ],
+	[ new MongoDB\BSON\Regex( '^a', 'i' ), new MongoDB\BSON\Regex( '^a', 'i' ), new MongoDB\BSON\Regex( '^a', 'm' ) ],
+	[ new MongoDB\BSON\Timestamp( 1234, 5678 ), new MongoDB\BSON\Timestamp( 1234, 5678 ), new MongoDB\BSON\Timestamp( 1234, 5679 ) ],
+	[ new MongoDB\BSON\UTCDateTime( 1416445411987 ), new MongoDB\BSON\UTCDateTime( 1416445411987 ), new MongoDB\BSON\UTCDateTime( 0 ) ],
+];
+
+foreach ( $pairs as list( $a, $same, $other ) )
+{
+	/* Also compare with a copy that went through BSON */
+	$decoded = MongoDB\BSON\toPHP( MongoDB\BSON\fromPHP( [ 'v' => $a ] ) )->v;
+
+	echo get_class( $a ), ': ';
+	var_dump( $a == $same, $a == $decoded, $a == $other );
+}
+
+var_dump( ( new MongoDB\BSON\Binary( 'foo', 0 ) )->getType( 1 ) );
+?>
+--EXPECTF--
+MongoDB\BSON\Binary: bool(true)
+bool(true)
+bool(false)
+MongoDB\BSON\Javascript: bool(true)
+bool(true)
+bool(false)
+MongoDB\BSON\Regex: bool(true)
+bool(true)
+bool(false)
+MongoDB\BSON\Timestamp: bool(true)
+bool(true)
+bool(false)
+MongoDB\BSON\UTCDateTime: bool(true)
+bool(true)
+bool(false)
+
+Warning: MongoDB\BSON\Binary::getType() expects exactly 0 parameters, 1 given in %s on line %d
+NULL
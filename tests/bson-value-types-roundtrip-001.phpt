@@ -0,0 +1,58 @@
+--TEST--
+BSON value types survive a fromPHP()/toPHP() round trip
+--FILE--
+<?php
+$values = [
+	new MongoDB\BSON\Binary("Hello!", 0x44),
+	new MongoDB\BSON\Javascript("function() { return x; }", [ 'x' => 42 ]),
+	new MongoDB\BSON\Regex("^foo", "i"),
+	new MongoDB\BSON\Timestamp(1234, 5678),
+	new MongoDB\BSON\UTCDateTime(1416445411987),
+];
+
+foreach ( $values as $value )
+{
+	$document = MongoDB\BSON\toPHP( MongoDB\BSON\fromPHP( [ 'v' => $value ] ) );
+	var_dump( $document->v );
+}
+
+$copy = clone $values[2];
+echo $copy, "\n";
+echo $values[3], "\n";
+echo $values[4], "\n";
+?>
+--EXPECTF--
+object(MongoDB\BSON\Binary)#%d (2) {
+  ["data"]=>
+  string(6) "Hello!"
+  ["type"]=>
+  int(68)
+}
+object(MongoDB\BSON\Javascript)#%d (2) {
+  ["javascript"]=>
+  string(24) "function() { return x; }"
+  ["scope"]=>
+  object(stdClass)#%d (1) {
+    ["x"]=>
+    int(42)
+  }
+}
+object(MongoDB\BSON\Regex)#%d (2) {
+  ["pattern"]=>
+  string(4) "^foo"
+  ["flags"]=>
+  string(1) "i"
+}
+object(MongoDB\BSON\Timestamp)#%d (2) {
+  ["increment"]=>
+  int(1234)
+  ["timestamp"]=>
+  int(5678)
+}
+object(MongoDB\BSON\UTCDateTime)#%d (1) {
+  ["milliseconds"]=>
+  int(1416445411987)
+}
+/^foo/i
+[1234:5678]
+1416445411987
@@ -20,6 +20,7 @@
 #include "hphp/runtime/vm/native-data.h"
 
 #include "bson.h"
+#include "pool.h"
 #include "utils.h"
 #include "mongodb.h"
 
@@ -189,6 +190,7 @@ HPHP::Object Utils::doExecuteBulkWrite(const HPHP::String ns, mongoc_client_t *c
 	bson_error_t error;
 	int success;
 	bson_t reply = BSON_INITIALIZER;
+	auto client_guard = HPHP::Pool::LockClient(client);
 
 	if (bulk_data->m_executed == true) {
 		throw throwBulkWriteException("BulkWrite objects may only be executed once and this instance has already been executed");
@@ -259,7 +261,14 @@ const HPHP::StaticString
 	s_batchSize("batchSize"),
 	s_flags("flags"),
 	s_fields("fields"),
-	s_readConcern("readConcern");
+	s_readConcern("readConcern"),
+	s_maxAwaitTimeMS("maxAwaitTimeMS"),
+	s_prefetch("prefetch"),
+	s_prefetchMaxBytes("prefetchMaxBytes");
+
+/* Upper bound on what a prefetching cursor buffers ahead of PHP, unless the
+ * query sets "prefetchMaxBytes" */
+#define HIPPO_CURSOR_PREFETCH_DEFAULT_MAX_BYTES (16 * 1024 * 1024)
 
 
 HPHP::Object Utils::doExecuteCommand(const char *db, mongoc_client_t *client, int server_id, const HPHP::Object &command, const HPHP::Variant &readPreference)
@@ -274,6 +283,10 @@ HPHP::Object Utils::doExecuteCommand(const char *db, mongoc_client_t *client, in
 	bson = bson_new();
 	converter.convert(bson);
 
+	/* Only taken now, as converting can call back into userland through
+	 * bsonSerialize(), which may well use the same client */
+	auto client_guard = HPHP::Pool::LockClient(client);
+
 	if (!readPreference.isNull()) {
 		HPHP::Object o_rp = readPreference.toObject();
 		HPHP::MongoDBDriverReadPreferenceData* data = HPHP::Native::data<HPHP::MongoDBDriverReadPreferenceData>(o_rp);
@@ -326,8 +339,11 @@ HPHP::Object Utils::doExecuteQuery(const HPHP::String ns, mongoc_client_t *clien
 	mongoc_query_flags_t flags;
 	char *dbname;
 	char *collname;
+	size_t prefetch_max_bytes = 0;
+	int64_t max_await_time_ms = -1;
 
 	mongoc_read_prefs_t *read_preference = NULL;
+	mongoc_read_concern_t *read_concern = NULL;
 
 	/* Prepare */
 	if (!MongoDriver::Utils::splitNamespace(ns, &dbname, &collname)) {
@@ -356,12 +372,20 @@ HPHP::Object Utils::doExecuteQuery(const HPHP::String ns, mongoc_client_t *clien
 		}
 
 		if (aquery.exists(s_readConcern)) {
-			mongoc_read_concern_t *rc;
+			read_concern = mongoc_read_concern_new();
+			mongoc_read_concern_set_level(read_concern, aquery[s_readConcern].toString().c_str());
+		}
 
-			rc = mongoc_read_concern_new();
-			mongoc_read_concern_set_level(rc, aquery[s_readConcern].toString().c_str());
+		if (aquery.exists(s_maxAwaitTimeMS)) {
+			max_await_time_ms = aquery[s_maxAwaitTimeMS].toInt64();
+		}
 
-			mongoc_client_set_read_concern(client, rc);
+		if (aquery[s_prefetch].toBoolean()) {
+			if (aquery.exists(s_prefetchMaxBytes)) {
+				prefetch_max_bytes = aquery[s_prefetchMaxBytes].toInt64();
+			} else {
+				prefetch_max_bytes = HIPPO_CURSOR_PREFETCH_DEFAULT_MAX_BYTES;
+			}
 		}
 	}
 
@@ -372,6 +396,16 @@ HPHP::Object Utils::doExecuteQuery(const HPHP::String ns, mongoc_client_t *clien
 		read_preference = data->m_read_preference;
 	}
 
+	/* Only taken now, as converting the filter and projection can call back
+	 * into userland through bsonSerialize(), which may well use the same
+	 * client */
+	auto client_guard = HPHP::Pool::LockClient(client);
+
+	if (read_concern) {
+		mongoc_client_set_read_concern(client, read_concern);
+		mongoc_read_concern_destroy(read_concern);
+	}
+
 	/* Run query and get cursor */
 	collection = mongoc_client_get_collection(client, dbname, collname);
 	cursor = mongoc_collection_find(collection, flags, skip, limit, batch_size, bson_query, bson_fields, read_preference);
@@ -382,11 +416,22 @@ HPHP::Object Utils::doExecuteQuery(const HPHP::String ns, mongoc_client_t *clien
 		throw throwRunTimeException("Could not set cursor server_id");
 	}
 
+	/* Only used for the getMores of tailable awaitData cursors */
+	if (max_await_time_ms >= 0) {
+		mongoc_cursor_set_max_await_time_ms(cursor, (uint32_t) max_await_time_ms);
+	}
+
 	/* This throws an exception upon error */
 	hippo_advance_cursor_and_check_for_error(cursor);
 
 	/* Prepare result */
-	return HPHP::hippo_cursor_init_for_query(cursor, client, ns, query, readPreference);
+	HPHP::Object obj = HPHP::hippo_cursor_init_for_query(cursor, client, ns, query, readPreference);
+
+	if (prefetch_max_bytes) {
+		HPHP::hippo_cursor_start_prefetch(obj, prefetch_max_bytes);
+	}
+
+	return obj;
 }
 
 